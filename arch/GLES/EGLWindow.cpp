@@ -16,7 +16,13 @@
 */
 #include "EGLWindow.h"
 #include "EGLConfig.h"
-#include "GLES/gl.h"
+// not GLES.h, the macros of ShaderCompat.h would
+// rewrite the prototypes of the GLES1 header
+#ifdef USE_GLES2
+#include <GLES2/gl2.h>
+#else
+#include <GLES/gl.h>
+#endif
 #include <cstdlib>
 #include <iostream>
 #include <cassert>
@@ -91,7 +97,11 @@ void EGLWindow::makeSurface(uint32_t _x, uint32_t _y, uint32_t _w, uint32_t _h)
 	// config you use OpenGL ES2.0 by default
 	static const EGLint contextAttributes[] =
     {
+#ifdef USE_GLES2
+        EGL_CONTEXT_CLIENT_VERSION, 2,
+#else
         EGL_CONTEXT_CLIENT_VERSION, 1,
+#endif
 		EGL_NONE
 	};
 
@@ -210,6 +220,16 @@ void EGLWindow::swapBuffers() const
 	eglSwapBuffers(m_display, m_surface);
 }
 
+bool EGLWindow::preserveBuffer()
+{
+	return eglSurfaceAttrib(m_display, m_surface, EGL_SWAP_BEHAVIOR, EGL_BUFFER_PRESERVED) == EGL_TRUE;
+}
+
+bool EGLWindow::setSwapInterval(int _interval)
+{
+	return eglSwapInterval(m_display, _interval) == EGL_TRUE;
+}
+
 void EGLWindow::resizeScreen(uint32_t _w, uint32_t _h)
 {
 	destroySurface();
@@ -19,7 +19,6 @@
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
-#include <GLES/gl.h>
 #include <bcm_host.h>
 
 #include "EGLConfig.h"
@@ -42,6 +41,13 @@ class EGLWindow
 		virtual void paintGL()=0;
 		/// @brief tell EGL to re-draw the current buffer
 		void swapBuffers() const;
+		/// @brief keep the content of the back buffer when swapping,
+		/// so only changed parts need to be drawn again
+		/// @returns false if the surface's config doesn't support it
+		bool preserveBuffer();
+		/// @brief set the minimum number of vsyncs per swap
+		/// @returns false if the interval is not supported
+		bool setSwapInterval(int _interval);
 		/// @brief resize the screen with origin at 0,0
 		/// @param _w the width
 		/// @param _h the height
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <unistd.h>
+#include <time.h>
 
 #include "GLES.h"
 #include "MyGLWindow.h"
@@ -7,6 +8,7 @@
 #include "PiGLETApp.h"
 
 static MyGLWindow* win;
+static bool preserved = false;
 
 void InitGL() {
     std::cout << "Starting InitGL" << std::endl;
@@ -19,8 +21,19 @@ void InitGL() {
 
     // enable stencil buffer
     config->setAttribute(EGL_STENCIL_SIZE,1);
+#ifdef USE_GLES2
+    config->setAttribute(EGL_RENDERABLE_TYPE,EGL_OPENGL_ES2_BIT);
+#endif
     // now create a new window using the default config
     win = new MyGLWindow(config);
+
+    // then only the changed windows are drawn each frame
+    preserved = win->preserveBuffer();
+    std::cout << "Back buffer preserved: " << (preserved ? "yes" : "no") << std::endl;
+
+    // swapping waits for the display, the frame rate is
+    // limited further by the PiGLETApp
+    SetSwapInterval(1);
     
     CommonInitGL();
 }
@@ -28,11 +41,26 @@ void InitGL() {
 void RunGL() {
     while(1) {
         win->paintGL();
-        usleep(1000); // give other threads (especially EPICS callbacks) some time
+        // sleeping gives the other threads (especially EPICS callbacks) some time
+        const double wait = PiGLETApp::I().EndFrame();
+        if(wait > 0) {
+            timespec t;
+            t.tv_sec = (time_t)wait;
+            t.tv_nsec = (long)(1e9*(wait - t.tv_sec));
+            nanosleep(&t, NULL);
+        }
     }
     bcm_host_deinit();
 }
 
+bool IsBufferPreserved() {
+    return preserved;
+}
+
+bool SetSwapInterval(const int interval) {
+    return win->setSwapInterval(interval);
+}
+
 int GetWindowWidth() {
     return win->getWidth();
 }
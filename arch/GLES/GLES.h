@@ -3,7 +3,23 @@
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
+#ifdef USE_GLES2
+#include <GLES2/gl2.h>
+#include "ShaderCompat.h"
+#else
+#define GL_GLEXT_PROTOTYPES
 #include <GLES/gl.h>
+#include <GLES/glext.h>
+// framebuffer objects are an extension (OES_framebuffer_object) in GLES 1.1
+#define glGenFramebuffers           glGenFramebuffersOES
+#define glDeleteFramebuffers        glDeleteFramebuffersOES
+#define glBindFramebuffer           glBindFramebufferOES
+#define glFramebufferTexture2D      glFramebufferTexture2DOES
+#define glCheckFramebufferStatus    glCheckFramebufferStatusOES
+#define GL_FRAMEBUFFER              GL_FRAMEBUFFER_OES
+#define GL_COLOR_ATTACHMENT0        GL_COLOR_ATTACHMENT0_OES
+#define GL_FRAMEBUFFER_COMPLETE     GL_FRAMEBUFFER_COMPLETE_OES
+#endif
 #include "bcm_host.h"
 
 void InitGL();
@@ -11,11 +27,17 @@ void RunGL();
 
 int GetWindowWidth();
 int GetWindowHeight();
+// if the back buffer keeps its content after swapping
+bool IsBufferPreserved();
+// number of vertical syncs to wait for when swapping, 0 disables vsync
+bool SetSwapInterval(const int interval);
 void ReportGLError();
 
+#ifndef USE_GLES2
 // add this missing command on GLES arch
 inline void glColor4fv( const float* c ) {
     glColor4f( c[0], c[1], c[2], c[3]);
 }
+#endif
 
 #endif
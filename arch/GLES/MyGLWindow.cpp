@@ -39,9 +39,11 @@ void MyGLWindow::initializeGL()
 
 void MyGLWindow::paintGL()
 {
-    PiGLETApp::I().Draw();    
-	glFlush();
-	glFinish();
-	swapBuffers();
+    // the last frame stays on screen if nothing changed
+    // swapping flushes, don't wait for the GPU here
+    if(!PiGLETApp::I().Draw())
+        return;
+
+    swapBuffers();
 }
 
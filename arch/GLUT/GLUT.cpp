@@ -6,6 +6,10 @@
 #include "arch_common.h"
 #include "PiGLETApp.h"
 
+// from GL/glx.h, which can't be included since
+// the X11 typedef Window clashes with our class
+extern "C" void (*glXGetProcAddressARB(const GLubyte* procName))(void);
+
 using namespace std;
 
 static bool fullscreen = false;
@@ -26,12 +30,28 @@ int GetWindowHeight() {
     return _height;
 }
 
+bool IsBufferPreserved() {
+    // the back buffer is undefined after swapping
+    return false;
+}
+
+bool SetSwapInterval(const int interval) {
+    // there is no portable way, try the GLX extensions
+    // (the SGI one can't switch vsync off)
+    typedef int (*SwapIntervalProc)(int);
+    SwapIntervalProc proc = (SwapIntervalProc)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalMESA");
+    if(proc == NULL && interval > 0)
+        proc = (SwapIntervalProc)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalSGI");
+    return proc != NULL && proc(interval) == 0;
+}
+
 static void drawCallback(int val) {
-    PiGLETApp::I().Draw();
-    glFlush();
-    glFinish();
-    glutSwapBuffers();
-    glutTimerFunc(20, drawCallback, 0);
+    // the last frame stays on screen if nothing changed,
+    // swapping flushes, don't wait for the GPU here
+    if(PiGLETApp::I().Draw())
+        glutSwapBuffers();
+    const double wait = PiGLETApp::I().EndFrame();
+    glutTimerFunc((unsigned int)(1e3*wait + .5), drawCallback, 0);
 }
 
 void toggleFullscreen() {
@@ -73,6 +93,7 @@ void InitGL(){
     glutTimerFunc(0, drawCallback, 0);
     glutKeyboardFunc(keyPressed);
 //    glutReshapeFunc(Reshape);
+    SetSwapInterval(1);
     CommonInitGL();
 }
 
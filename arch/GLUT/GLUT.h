@@ -1,7 +1,12 @@
 #ifndef GLUT_H
 #define GLUT_H
 
+// for the buffer objects (OpenGL 1.5) and shaders (OpenGL 2.0)
+#define GL_GLEXT_PROTOTYPES
 #include <GL/glut.h>
+#ifdef USE_GLES2
+#include "ShaderCompat.h"
+#endif
 
 #define DEFAULT_WINDOW_WIDTH    1024
 #define DEFAULT_WINDOW_HEIGHT   1024/1.6
@@ -11,6 +16,10 @@ void RunGL();
 
 int GetWindowWidth();
 int GetWindowHeight();
+// if the back buffer keeps its content after swapping
+bool IsBufferPreserved();
+// number of vertical syncs to wait for when swapping, 0 disables vsync
+bool SetSwapInterval(const int interval);
 
 void ReportGLError();
 
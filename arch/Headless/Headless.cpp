@@ -0,0 +1,196 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <wand/magick_wand.h>
+
+#include "Headless.h"
+#include "arch_common.h"
+#include "PiGLETApp.h"
+#include "ConfigManager.h"
+
+using namespace std;
+
+// there is no display, so it's configured by the environment:
+// PIGLET_SIZE      size of the pbuffer, e.g. 1920x1080
+// PIGLET_DUMP      filename pattern for each drawn frame, e.g. frame%05d.png
+// PIGLET_FRAMES    exit after this number of frames (drawn or not)
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLSurface surface = EGL_NO_SURFACE;
+static EGLContext context = EGL_NO_CONTEXT;
+
+static int _width =  DEFAULT_WINDOW_WIDTH;
+static int _height = DEFAULT_WINDOW_HEIGHT;
+
+static string dump_pattern;
+static unsigned long max_frames = 0;
+
+int GetWindowWidth() {
+    return _width;
+}
+
+int GetWindowHeight() {
+    return _height;
+}
+
+bool IsBufferPreserved() {
+    // a pbuffer is never swapped
+    return true;
+}
+
+bool SetSwapInterval(const int interval) {
+    // nothing to wait for
+    return interval == 0;
+}
+
+void ReportGLError() {
+    GLenum err = glGetError();
+    if(err != GL_NO_ERROR) {
+        cerr << "OpenGL Error (fix that!): " << err << endl;
+    }
+}
+
+bool DumpFrame(const string& filename) {
+    vector<unsigned char> pixels(3*_width*_height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, _width, _height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+    // does nothing if already done
+    MagickWandGenesis();
+    MagickWand* mw = NewMagickWand();
+    bool ok = MagickConstituteImage(mw, _width, _height, "RGB", CharPixel, &pixels[0]) == MagickTrue;
+    // the rows of GL start at the bottom
+    ok = ok && MagickFlipImage(mw) == MagickTrue;
+    ok = ok && MagickWriteImage(mw, filename.c_str()) == MagickTrue;
+    DestroyMagickWand(mw);
+    if(!ok)
+        cerr << "Could not write frame to " << filename << endl;
+    return ok;
+}
+
+// not static, template arguments need external linkage
+string callbackDumpFrame(const string& arg) {
+    if(arg.empty())
+        return "Filename required";
+    // executed right after drawing, the pbuffer holds the complete frame
+    if(!DumpFrame(arg))
+        return "Could not write "+arg;
+    return ""; // success
+}
+
+static EGLDisplay GetDisplay() {
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    // Mesa doesn't need any window system then
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(getPlatformDisplay != NULL) {
+        EGLDisplay d = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if(d != EGL_NO_DISPLAY)
+            return d;
+    }
+#endif
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+static void Fail(const string& what) {
+    cerr << "Headless: " << what << " failed, EGL error " << hex << eglGetError() << endl;
+    exit(EXIT_FAILURE);
+}
+
+void InitGL(){
+    cout << "Headless Init" << endl;
+
+    const char* size = getenv("PIGLET_SIZE");
+    if(size != NULL && sscanf(size, "%dx%d", &_width, &_height) != 2) {
+        cerr << "PIGLET_SIZE must be like 1024x640" << endl;
+        exit(EXIT_FAILURE);
+    }
+    const char* dump = getenv("PIGLET_DUMP");
+    if(dump != NULL)
+        dump_pattern = dump;
+    const char* frames = getenv("PIGLET_FRAMES");
+    if(frames != NULL)
+        max_frames = strtoul(frames, NULL, 10);
+
+    display = GetDisplay();
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+        Fail("eglInitialize");
+    if(!eglBindAPI(EGL_OPENGL_API))
+        Fail("eglBindAPI");
+
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_STENCIL_SIZE, 1,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint n = 0;
+    if(!eglChooseConfig(display, config_attribs, &config, 1, &n) || n < 1)
+        Fail("eglChooseConfig");
+
+    const EGLint pbuffer_attribs[] = {
+        EGL_WIDTH, _width,
+        EGL_HEIGHT, _height,
+        EGL_NONE
+    };
+    surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+    if(surface == EGL_NO_SURFACE)
+        Fail("eglCreatePbufferSurface");
+
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if(context == EGL_NO_CONTEXT)
+        Fail("eglCreateContext");
+    if(!eglMakeCurrent(display, surface, surface, context))
+        Fail("eglMakeCurrent");
+
+    cout << "Rendering " << _width << "x" << _height << " with " << glGetString(GL_RENDERER) << endl;
+
+    glViewport(0, 0, _width, _height);
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0);
+    CommonInitGL();
+
+    ConfigManager::I().addCmd("DumpFrame", BIND_FREE_CB(&callbackDumpFrame));
+}
+
+void RunGL() {
+    PiGLETApp::I().Init();
+    unsigned long frame = 0;
+    unsigned long dumped = 0;
+    while(max_frames == 0 || frame < max_frames) {
+        if(PiGLETApp::I().Draw()) {
+            // software rendering may be threaded (llvmpipe),
+            // wait for it to measure the real frame time
+            glFinish();
+            if(!dump_pattern.empty()) {
+                char filename[1024];
+                snprintf(filename, sizeof(filename), dump_pattern.c_str(), dumped++);
+                DumpFrame(filename);
+            }
+        }
+        frame++;
+
+        const double wait = PiGLETApp::I().EndFrame();
+        if(wait > 0) {
+            timespec t;
+            t.tv_sec = (time_t)wait;
+            t.tv_nsec = (long)(1e9*(wait - t.tv_sec));
+            nanosleep(&t, NULL);
+        }
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglDestroySurface(display, surface);
+    eglTerminate(display);
+}
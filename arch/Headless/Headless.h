@@ -0,0 +1,34 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <string>
+
+// desktop OpenGL via EGL, rendering into a pbuffer
+// for the buffer objects (OpenGL 1.5) and shaders (OpenGL 2.0)
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#ifdef USE_GLES2
+#include "ShaderCompat.h"
+#endif
+
+#define DEFAULT_WINDOW_WIDTH    1024
+#define DEFAULT_WINDOW_HEIGHT   640
+
+void InitGL();
+void RunGL();
+
+int GetWindowWidth();
+int GetWindowHeight();
+// if the back buffer keeps its content after swapping
+bool IsBufferPreserved();
+// number of vertical syncs to wait for when swapping, 0 disables vsync
+bool SetSwapInterval(const int interval);
+
+void ReportGLError();
+
+// write the current content of the pbuffer, e.g. as PNG
+bool DumpFrame(const std::string& filename);
+
+#endif
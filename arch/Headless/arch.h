@@ -0,0 +1,6 @@
+#ifndef ARCH_H
+#define ARCH_H
+
+#include "Headless.h"
+
+#endif
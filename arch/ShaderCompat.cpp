@@ -0,0 +1,256 @@
+#include <iostream>
+#include <vector>
+#include <string.h>
+
+#define SHADERCOMPAT_NO_MACROS
+#include "arch.h"
+
+using namespace std;
+
+namespace ShaderCompat {
+
+typedef struct {
+    GLfloat m[16]; // column-major, as GL expects it
+} matrix_t;
+
+static const char* vertex_src =
+        "attribute vec2 a_pos;\n"
+        "attribute vec2 a_tex;\n"
+        "uniform mat4 u_mvp;\n"
+        "varying vec2 v_tex;\n"
+        "void main() {\n"
+        "    v_tex = a_tex;\n"
+        "    gl_Position = u_mvp * vec4(a_pos, 0.0, 1.0);\n"
+        "}\n";
+
+// the texture modulates the color, as GL_MODULATE does
+static const char* fragment_src =
+        "#ifdef GL_ES\n"
+        "precision mediump float;\n"
+        "#endif\n"
+        "uniform vec4 u_color;\n"
+        "uniform float u_textured;\n"
+        "uniform sampler2D u_tex;\n"
+        "varying vec2 v_tex;\n"
+        "void main() {\n"
+        "    gl_FragColor = u_color * mix(vec4(1.0), texture2D(u_tex, v_tex), u_textured);\n"
+        "}\n";
+
+// attribute locations, bound before linking
+static const GLuint a_pos = 0;
+static const GLuint a_tex = 1;
+
+static GLuint program = 0;
+static GLint u_mvp = -1;
+static GLint u_color = -1;
+static GLint u_textured = -1;
+
+static vector<matrix_t> modelview(1);
+static vector<matrix_t> projection(1);
+static vector<matrix_t>* current = &modelview;
+static bool mvp_dirty = true;
+
+static GLfloat color[4] = {1, 1, 1, 1};
+static bool color_dirty = true;
+
+static bool texture_enabled = false;
+static bool texcoord_enabled = false;
+
+static void Identity( matrix_t& M )
+{
+    memset(M.m, 0, sizeof(M.m));
+    M.m[0] = M.m[5] = M.m[10] = M.m[15] = 1.0f;
+}
+
+// M = M * R
+static void Multiply( matrix_t& M, const matrix_t& R )
+{
+    matrix_t res;
+    for( int c=0; c<4; ++c ) {
+        for( int r=0; r<4; ++r ) {
+            GLfloat s = 0;
+            for( int k=0; k<4; ++k )
+                s += M.m[k*4+r] * R.m[c*4+k];
+            res.m[c*4+r] = s;
+        }
+    }
+    M = res;
+}
+
+static GLuint Compile( const GLenum type, const char* src )
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &src, NULL);
+    glCompileShader(shader);
+    GLint ok = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if( !ok ) {
+        char log[512];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        cerr << "Shader compilation failed: " << log << endl;
+    }
+    return shader;
+}
+
+void Init()
+{
+    program = glCreateProgram();
+    glAttachShader(program, Compile(GL_VERTEX_SHADER, vertex_src));
+    glAttachShader(program, Compile(GL_FRAGMENT_SHADER, fragment_src));
+    glBindAttribLocation(program, a_pos, "a_pos");
+    glBindAttribLocation(program, a_tex, "a_tex");
+    glLinkProgram(program);
+    GLint ok = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if( !ok ) {
+        char log[512];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        cerr << "Shader linking failed: " << log << endl;
+    }
+    glUseProgram(program);
+
+    u_mvp = glGetUniformLocation(program, "u_mvp");
+    u_color = glGetUniformLocation(program, "u_color");
+    u_textured = glGetUniformLocation(program, "u_textured");
+    glUniform1i(glGetUniformLocation(program, "u_tex"), 0);
+
+    Identity(modelview.back());
+    Identity(projection.back());
+    cout << "Using the shader pipeline" << endl;
+}
+
+void MatrixMode( const GLenum mode )
+{
+    current = mode == GL_PROJECTION ? &projection : &modelview;
+}
+
+void LoadIdentity()
+{
+    Identity(current->back());
+    mvp_dirty = true;
+}
+
+void Ortho( const GLfloat left, const GLfloat right, const GLfloat bottom,
+            const GLfloat top, const GLfloat near, const GLfloat far )
+{
+    matrix_t R;
+    Identity(R);
+    R.m[0]  = 2.0f / (right - left);
+    R.m[5]  = 2.0f / (top - bottom);
+    R.m[10] = -2.0f / (far - near);
+    R.m[12] = -(right + left) / (right - left);
+    R.m[13] = -(top + bottom) / (top - bottom);
+    R.m[14] = -(far + near) / (far - near);
+    Multiply(current->back(), R);
+    mvp_dirty = true;
+}
+
+void PushMatrix()
+{
+    current->push_back(current->back());
+}
+
+void PopMatrix()
+{
+    if( current->size() > 1 ) {
+        current->pop_back();
+        mvp_dirty = true;
+    }
+}
+
+void Translate( const GLfloat x, const GLfloat y, const GLfloat z )
+{
+    // only the last column changes
+    GLfloat* m = current->back().m;
+    for( int r=0; r<4; ++r )
+        m[12+r] += m[r]*x + m[4+r]*y + m[8+r]*z;
+    mvp_dirty = true;
+}
+
+void Scale( const GLfloat x, const GLfloat y, const GLfloat z )
+{
+    GLfloat* m = current->back().m;
+    for( int r=0; r<4; ++r ) {
+        m[r]   *= x;
+        m[4+r] *= y;
+        m[8+r] *= z;
+    }
+    mvp_dirty = true;
+}
+
+void Color4f( const GLfloat r, const GLfloat g, const GLfloat b, const GLfloat a )
+{
+    color[0] = r;
+    color[1] = g;
+    color[2] = b;
+    color[3] = a;
+    color_dirty = true;
+}
+
+void VertexPointer( const GLint size, const GLenum type, const GLsizei stride, const GLvoid* p )
+{
+    glVertexAttribPointer(a_pos, size, type, GL_FALSE, stride, p);
+}
+
+void TexCoordPointer( const GLint size, const GLenum type, const GLsizei stride, const GLvoid* p )
+{
+    glVertexAttribPointer(a_tex, size, type, GL_FALSE, stride, p);
+}
+
+void EnableClientState( const GLenum array )
+{
+    if( array == GL_VERTEX_ARRAY ) {
+        glEnableVertexAttribArray(a_pos);
+    }
+    else if( array == GL_TEXTURE_COORD_ARRAY ) {
+        glEnableVertexAttribArray(a_tex);
+        texcoord_enabled = true;
+    }
+}
+
+void DisableClientState( const GLenum array )
+{
+    if( array == GL_VERTEX_ARRAY ) {
+        glDisableVertexAttribArray(a_pos);
+    }
+    else if( array == GL_TEXTURE_COORD_ARRAY ) {
+        glDisableVertexAttribArray(a_tex);
+        texcoord_enabled = false;
+    }
+}
+
+void Enable( const GLenum cap )
+{
+    if( cap == GL_TEXTURE_2D )
+        texture_enabled = true;
+    else
+        glEnable(cap);
+}
+
+void Disable( const GLenum cap )
+{
+    if( cap == GL_TEXTURE_2D )
+        texture_enabled = false;
+    else
+        glDisable(cap);
+}
+
+void DrawArrays( const GLenum mode, const GLint first, const GLsizei count )
+{
+    // only changed uniforms are sent
+    if( mvp_dirty ) {
+        matrix_t mvp = projection.back();
+        Multiply(mvp, modelview.back());
+        glUniformMatrix4fv(u_mvp, 1, GL_FALSE, mvp.m);
+        mvp_dirty = false;
+    }
+    if( color_dirty ) {
+        glUniform4fv(u_color, 1, color);
+        color_dirty = false;
+    }
+    glUniform1f(u_textured, texture_enabled && texcoord_enabled ? 1.0f : 0.0f);
+
+    glDrawArrays(mode, first, count);
+}
+
+}
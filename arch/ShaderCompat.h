@@ -0,0 +1,70 @@
+#ifndef SHADERCOMPAT_H
+#define SHADERCOMPAT_H
+
+// Shader-based replacement for the fixed-function subset PiGLET uses,
+// selected with -DUSE_GLES2 (GLES2 on the Pi, OpenGL 2.1 otherwise).
+// The matrix stacks are kept here and passed as one uniform matrix,
+// so moving a graph (e.g. scrolling the time axis) never touches vertices.
+// Include it after the GL headers of the arch.
+
+#ifndef GL_MODELVIEW
+#define GL_MODELVIEW            0x1700
+#define GL_PROJECTION           0x1701
+#endif
+#ifndef GL_VERTEX_ARRAY
+#define GL_VERTEX_ARRAY         0x8074
+#define GL_TEXTURE_COORD_ARRAY  0x8078
+#endif
+
+namespace ShaderCompat {
+
+// compile the program, call it right after creating the context
+void Init();
+
+void MatrixMode( const GLenum mode );
+void LoadIdentity();
+void Ortho( const GLfloat left, const GLfloat right, const GLfloat bottom,
+            const GLfloat top, const GLfloat near, const GLfloat far );
+void PushMatrix();
+void PopMatrix();
+void Translate( const GLfloat x, const GLfloat y, const GLfloat z );
+void Scale( const GLfloat x, const GLfloat y, const GLfloat z );
+
+void Color4f( const GLfloat r, const GLfloat g, const GLfloat b, const GLfloat a );
+inline void Color4fv( const GLfloat* c ) { Color4f(c[0], c[1], c[2], c[3]); }
+
+// like the fixed-function calls, the currently bound
+// buffer object is captured when setting the pointers
+void VertexPointer( const GLint size, const GLenum type, const GLsizei stride, const GLvoid* p );
+void TexCoordPointer( const GLint size, const GLenum type, const GLsizei stride, const GLvoid* p );
+void EnableClientState( const GLenum array );
+void DisableClientState( const GLenum array );
+
+// GL_TEXTURE_2D is handled here, everything else is passed on
+void Enable( const GLenum cap );
+void Disable( const GLenum cap );
+
+void DrawArrays( const GLenum mode, const GLint first, const GLsizei count );
+
+}
+
+#ifndef SHADERCOMPAT_NO_MACROS
+#define glMatrixMode        ShaderCompat::MatrixMode
+#define glLoadIdentity      ShaderCompat::LoadIdentity
+#define glOrtho             ShaderCompat::Ortho
+#define glPushMatrix        ShaderCompat::PushMatrix
+#define glPopMatrix         ShaderCompat::PopMatrix
+#define glTranslatef        ShaderCompat::Translate
+#define glScalef            ShaderCompat::Scale
+#define glColor4f           ShaderCompat::Color4f
+#define glColor4fv          ShaderCompat::Color4fv
+#define glVertexPointer     ShaderCompat::VertexPointer
+#define glTexCoordPointer   ShaderCompat::TexCoordPointer
+#define glEnableClientState ShaderCompat::EnableClientState
+#define glDisableClientState ShaderCompat::DisableClientState
+#define glEnable            ShaderCompat::Enable
+#define glDisable           ShaderCompat::Disable
+#define glDrawArrays        ShaderCompat::DrawArrays
+#endif
+
+#endif // SHADERCOMPAT_H
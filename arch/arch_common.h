@@ -4,6 +4,10 @@
 // this function is called for all archs,
 // as a last statement in their own InitGL
 void CommonInitGL() {
+#ifdef USE_GLES2
+    // replaces the fixed-function pipeline
+    ShaderCompat::Init();
+#endif
     // ..now some system-wide GL stuff
     // enable the vertex array always, since this is always used
     // but the GL_TEXTURE_COORD_ARRAY must not be enabled globally (otherwise: segfault!)
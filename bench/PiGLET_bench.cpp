@@ -0,0 +1,232 @@
+// End-to-end benchmark: synthetic samples are injected into the
+// queues of the Epics class, bypassing Channel Access, and drawn by
+// the WindowManager into the offscreen buffer of the headless arch.
+//
+// Usage: PiGLET_bench [--pvs N] [--rate Hz] [--backlength s]
+//                     [--duration s] [--warmup s] [--fps N]
+// The results are printed as "key: value" lines.
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <new>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "arch.h"
+#include "PiGLETApp.h"
+#include "PlotWindow.h"
+#include "Epics.h"
+
+using namespace std;
+
+// count the allocations, atomically since the EPICS
+// threads allocate as well (they are mostly idle without any IOC)
+static size_t allocations = 0;
+
+static size_t Allocations() {
+    return __sync_fetch_and_add(&allocations, 0);
+}
+
+void* operator new(size_t n) {
+    __sync_fetch_and_add(&allocations, 1);
+    void* p = malloc(n);
+    if(p == NULL)
+        throw bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    free(p);
+}
+
+struct Options {
+    int pvs;            // number of PlotWindows, one PV each
+    double rate;        // samples per second and PV
+    double backlength;  // seconds shown by the windows
+    double duration;    // seconds measured
+    double warmup;      // seconds before measuring
+    double fps;         // frames per second, 0 draws as fast as possible
+
+    Options(): pvs(4), rate(1000), backlength(60), duration(10), warmup(1), fps(50) {}
+};
+
+static void Usage() {
+    cerr << "Usage: PiGLET_bench [--pvs N] [--rate Hz] [--backlength s] "
+         << "[--duration s] [--warmup s] [--fps N]" << endl;
+    exit(EXIT_FAILURE);
+}
+
+static Options ParseOptions(int argc, char* argv[]) {
+    Options o;
+    for(int i=1;i<argc;i++) {
+        if(i+1 >= argc)
+            Usage();
+        const string opt = argv[i];
+        stringstream ss(argv[++i]);
+        bool ok;
+        if(opt == "--pvs")             ok = (ss >> o.pvs) && o.pvs > 0;
+        else if(opt == "--rate")       ok = (ss >> o.rate) && o.rate > 0;
+        else if(opt == "--backlength") ok = (ss >> o.backlength) && o.backlength > 0;
+        else if(opt == "--duration")   ok = (ss >> o.duration) && o.duration > 0;
+        else if(opt == "--warmup")     ok = (ss >> o.warmup) && o.warmup >= 0;
+        else if(opt == "--fps")        ok = (ss >> o.fps) && o.fps >= 0;
+        else                           ok = false;
+        if(!ok)
+            Usage();
+    }
+    return o;
+}
+
+static double Now() {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+static void SleepUntil(const double t) {
+    const double wait = t - Now();
+    if(wait <= 0)
+        return;
+    timespec ts;
+    ts.tv_sec = (time_t)wait;
+    ts.tv_nsec = (long)(1e9*(wait - ts.tv_sec));
+    nanosleep(&ts, NULL);
+}
+
+static double Percentile(const vector<double>& sorted, const double p) {
+    if(sorted.empty())
+        return 0;
+    return sorted[(size_t)(p * (sorted.size()-1) + .5)];
+}
+
+// the properties an IOC would send first
+static void InjectProperties(Epics::Producer p) {
+    const dbr_double_t hihi = 1.8, high = 1.5, low = -1.5, lolo = -1.8;
+    const dbr_short_t prec = 3;
+    dbr_string_t egu;
+    strncpy(egu, "a.u.", sizeof(egu));
+    Epics::I().InjectProperty(p, "HIHI", &hihi, sizeof(hihi));
+    Epics::I().InjectProperty(p, "HIGH", &high, sizeof(high));
+    Epics::I().InjectProperty(p, "LOW",  &low,  sizeof(low));
+    Epics::I().InjectProperty(p, "LOLO", &lolo, sizeof(lolo));
+    Epics::I().InjectProperty(p, "PREC", &prec, sizeof(prec));
+    Epics::I().InjectProperty(p, "EGU",  egu,   sizeof(egu));
+}
+
+int main(int argc, char* argv[])
+{
+    const Options o = ParseOptions(argc, argv);
+
+    // the channels are created, but never searched for
+    setenv("EPICS_CA_AUTO_ADDR_LIST", "NO", 1);
+    setenv("EPICS_CA_ADDR_LIST", "", 1);
+
+    InitGL();
+    PiGLETApp& app = PiGLETApp::I();
+    app.Init();
+
+    vector<Epics::Producer> producers;
+    for(int i=0;i<o.pvs;i++) {
+        stringstream name;
+        name << "Bench:PV" << i;
+        PlotWindow* win = new PlotWindow(&app.Windows(), name.str());
+        if(!app.Windows().AddWindow(win).empty()) {
+            cerr << "Could not add window for " << name.str() << endl;
+            return EXIT_FAILURE;
+        }
+        win->SetBackLength(o.backlength);
+        Epics::Producer p = Epics::I().findProducer(name.str());
+        Epics::I().InjectConnection(p, true);
+        InjectProperties(p);
+        producers.push_back(p);
+    }
+
+    const double start = Epics::I().GetCurrentTime();
+    const double begin = start + o.warmup;
+    const double end = begin + o.duration;
+    const double period = o.fps > 0 ? 1.0/o.fps : 0;
+
+    size_t injected = 0;        // samples per PV so far
+    size_t events = 0;          // while measuring
+    size_t frames = 0;
+    size_t alloc_draw = 0;
+    size_t alloc_inject = 0;
+    size_t dropped_begin = 0;
+    vector<double> frame_times;
+    frame_times.reserve((size_t)(o.duration * (o.fps > 0 ? o.fps : 1000)));
+    double next_frame = Now();
+    bool measuring = false;
+
+    for(double now = start; now < end; now = Epics::I().GetCurrentTime()) {
+        if(!measuring && now >= begin) {
+            measuring = true;
+            for(size_t i=0;i<producers.size();i++)
+                dropped_begin += Epics::I().Dropped(producers[i]);
+        }
+
+        // all samples which are due, evenly spaced
+        size_t a = Allocations();
+        const size_t due = (size_t)((now - start) * o.rate);
+        for(; injected < due; injected++) {
+            const double t = start + injected / o.rate;
+            for(size_t i=0;i<producers.size();i++) {
+                const double y = sin(2*M_PI*0.2*t + i) + 0.1*(rand()/(double)RAND_MAX - 0.5);
+                Epics::I().InjectValue(producers[i], t, y);
+            }
+            if(measuring)
+                events += producers.size();
+        }
+        if(measuring)
+            alloc_inject += Allocations() - a;
+
+        // the windows consume the queues while drawing
+        a = Allocations();
+        const double t0 = Now();
+        const bool drawn = app.Draw();
+        glFinish();
+        const double t1 = Now();
+        if(measuring && drawn) {
+            frames++;
+            frame_times.push_back(t1 - t0);
+            alloc_draw += Allocations() - a;
+        }
+
+        next_frame += period;
+        if(next_frame < t1)
+            next_frame = t1; // don't catch up
+        SleepUntil(next_frame);
+    }
+
+    size_t dropped = 0;
+    for(size_t i=0;i<producers.size();i++)
+        dropped += Epics::I().Dropped(producers[i]);
+    dropped -= dropped_begin;
+
+    sort(frame_times.begin(), frame_times.end());
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    cout << "pvs: " << o.pvs << endl
+         << "rate_per_pv: " << o.rate << endl
+         << "backlength_s: " << o.backlength << endl
+         << "duration_s: " << o.duration << endl
+         << "events_per_s: " << events / o.duration << endl
+         << "events_dropped: " << dropped << endl
+         << "frames_per_s: " << frames / o.duration << endl
+         << "frame_ms_p50: " << 1e3*Percentile(frame_times, .50) << endl
+         << "frame_ms_p90: " << 1e3*Percentile(frame_times, .90) << endl
+         << "frame_ms_p99: " << 1e3*Percentile(frame_times, .99) << endl
+         << "frame_ms_max: " << 1e3*Percentile(frame_times, 1.0) << endl
+         << "allocs_per_frame: " << (frames > 0 ? (double)alloc_draw / frames : 0) << endl
+         << "allocs_per_event: " << (events > 0 ? (double)alloc_inject / events : 0) << endl
+         << "peak_rss_kb: " << usage.ru_maxrss << endl;
+
+    // the singletons are torn down without waiting for the telnet thread
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,323 @@
+// Microbenchmarks of the hot paths: BlockList::Add, NumberLabel::FormatNumberSI,
+// SimpleGraph::roundX and UpdateTicks, Epics::processNewDataForPV.
+//
+// Usage: PiGLET_microbench [--baseline file] [--threshold percent] [--filter name] [--nogl]
+// Prints one "name<TAB>ns_per_op<TAB>ops" line per benchmark, which can be
+// saved as the baseline of a later run. With a baseline, the change in percent
+// is appended and the exit code is 1 if any benchmark got slower than the threshold.
+// A GL context is only created if a benchmark needing it is run, --nogl skips
+// those on machines without any display.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <time.h>
+
+#include "arch.h"
+#include "PiGLETApp.h"
+#include "PlotWindow.h"
+#include "SimpleGraph.h"
+#include "NumberLabel.h"
+#include "BlockBuffer.h"
+#include "Epics.h"
+
+using namespace std;
+
+// each benchmark is repeated, the median is reported
+#define REPETITIONS 7
+
+// keeps the compiler from optimizing the results away
+static volatile double sink = 0;
+
+static double Now() {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+// log-uniform in [10^lo, 10^hi], random sign if asked
+static double LogUniform(const double lo, const double hi, const bool sign) {
+    const double v = pow(10.0, lo + (hi-lo) * rand()/(double)RAND_MAX);
+    return sign && rand() % 2 ? -v : v;
+}
+
+static double Noise() {
+    return rand()/(double)RAND_MAX - 0.5;
+}
+
+// the widgets need a GL context and a window,
+// created once the first benchmark needing them is set up
+static Window* GLWindow() {
+    static PlotWindow* win = NULL;
+    if(win == NULL) {
+        InitGL();
+        PiGLETApp::I().Init();
+        win = new PlotWindow(&PiGLETApp::I().Windows(), "Microbench:Window");
+        PiGLETApp::I().Windows().AddWindow(win);
+    }
+    return win;
+}
+
+class Benchmark {
+public:
+    const string name;
+    const bool gl; // needs GLWindow()
+    Benchmark( const string& n, const bool needs_gl=false ): name(n), gl(needs_gl) {}
+    virtual ~Benchmark() {}
+    virtual void Setup() {}
+    /**
+     * @brief Run once
+     * @param ops number of operations done
+     * @return seconds spent in the measured code
+     */
+    virtual double Run( size_t& ops ) = 0;
+};
+
+// the trace of a PV updating with 1 kHz, shown for 60 s,
+// with the time advanced once per frame (50 Hz)
+class BenchBlockListAdd: public Benchmark {
+private:
+    BlockList _list;
+    double _t;
+    bool _ramp;
+    void Add( const size_t n ) {
+        for(size_t i=0;i<n;i++) {
+            _t += 1e-3;
+            dvec2_t s;
+            s.x = _t;
+            // a ramp is the worst case for the min/max window
+            s.y = _ramp ? _t : sin(_t) + 0.1*Noise();
+            _list.Add(s);
+            if(i % 20 == 0)
+                _list.SetNow(_t);
+        }
+    }
+public:
+    BenchBlockListAdd( const string& n, const bool ramp ):
+        Benchmark(n), _list(60), _t(0), _ramp(ramp) {}
+    void Setup() {
+        // reach the steady state, where old samples expire
+        Add(60000);
+    }
+    double Run( size_t& ops ) {
+        ops = 100000;
+        const double t0 = Now();
+        Add(ops);
+        return Now() - t0;
+    }
+};
+
+class BenchFormatNumberSI: public Benchmark {
+private:
+    NumberLabel _label;
+    vector<float> _values;
+public:
+    BenchFormatNumberSI(): Benchmark("NumberLabel::FormatNumberSI"), _label(NULL) {}
+    void Setup() {
+        // from pico to tera, some zeros
+        for(size_t i=0;i<10000;i++)
+            _values.push_back(i % 50 == 0 ? 0 : LogUniform(-12, 12, true));
+    }
+    double Run( size_t& ops ) {
+        ops = _values.size();
+        size_t len = 0;
+        const double t0 = Now();
+        for(size_t i=0;i<_values.size();i++)
+            len += _label.FormatNumberSI(_values[i]).size();
+        const double t = Now() - t0;
+        sink += len;
+        return t;
+    }
+};
+
+class BenchRoundX: public Benchmark {
+private:
+    vector<float> _values;
+public:
+    BenchRoundX(): Benchmark("SimpleGraph::roundX") {}
+    void Setup() {
+        // tick spacings of all kinds of ranges
+        for(size_t i=0;i<100000;i++)
+            _values.push_back(LogUniform(-9, 9, true));
+    }
+    double Run( size_t& ops ) {
+        ops = _values.size();
+        float sum = 0;
+        const double t0 = Now();
+        for(size_t i=0;i<_values.size();i++)
+            sum += SimpleGraph::roundX(_values[i]);
+        const double t = Now() - t0;
+        sink += sum;
+        return t;
+    }
+};
+
+class BenchUpdateTicks: public Benchmark {
+private:
+    SimpleGraph* _graph;
+    vector<Interval> _ranges;
+public:
+    BenchUpdateTicks():
+        Benchmark("SimpleGraph::UpdateTicks", true), _graph(NULL) {}
+    virtual ~BenchUpdateTicks() {
+        delete _graph;
+    }
+    void Setup() {
+        _graph = new SimpleGraph(GLWindow(), 60);
+        // ranges of any magnitude, some around zero
+        for(size_t i=0;i<2000;i++) {
+            const double len = LogUniform(-6, 6, false);
+            const double center = i % 3 == 0 ? 0 : len * 10 * Noise();
+            _ranges.push_back(Interval(center - len/2, center + len/2));
+        }
+    }
+    double Run( size_t& ops ) {
+        ops = _ranges.size();
+        double t = 0;
+        for(size_t i=0;i<_ranges.size();i++) {
+            _graph->SetYRangeMin(_ranges[i].Min());
+            _graph->SetYRangeMax(_ranges[i].Max());
+            const double t0 = Now();
+            _graph->UpdateTicks();
+            t += Now() - t0;
+        }
+        return t;
+    }
+};
+
+// not static, template arguments need external linkage
+void CountItem(const Epics::DataItem* i) {
+    sink += i->value.y;
+}
+
+// a consumer of a PV with 1000 updates per frame
+class BenchProcessNewData: public Benchmark {
+private:
+    Epics::Subscription _sub;
+    Epics::Producer _producer;
+    double _t;
+public:
+    BenchProcessNewData():
+        Benchmark("Epics::processNewDataForPV"), _sub(NULL), _producer(NULL), _t(0) {}
+    virtual ~BenchProcessNewData() {
+        if(_sub != NULL)
+            Epics::I().removePV(_sub);
+    }
+    void Setup() {
+        _sub = Epics::I().addPV("Microbench:PV", BIND_FREE_CB(&CountItem));
+        _producer = Epics::I().findProducer("Microbench:PV");
+        Epics::I().InjectConnection(_producer, true);
+    }
+    double Run( size_t& ops ) {
+        ops = 0;
+        double t = 0;
+        for(size_t frame=0;frame<100;frame++) {
+            for(size_t i=0;i<1000;i++) {
+                _t += 1e-6;
+                Epics::I().InjectValue(_producer, _t, sin(_t) + Noise());
+            }
+            ops += 1000;
+            const double t0 = Now();
+            Epics::I().processNewDataForPV(_sub);
+            t += Now() - t0;
+        }
+        return t;
+    }
+};
+
+static map<string, double> ReadBaseline(const string& filename) {
+    map<string, double> baseline;
+    ifstream f(filename.c_str());
+    if(!f) {
+        cerr << "Cannot read baseline " << filename << endl;
+        exit(EXIT_FAILURE);
+    }
+    string line;
+    while(getline(f, line)) {
+        if(line.empty() || line[0] == '#')
+            continue;
+        // the name may contain anything but tabs
+        const size_t tab = line.find('\t');
+        if(tab == string::npos)
+            continue;
+        baseline[line.substr(0, tab)] = atof(line.c_str() + tab + 1);
+    }
+    return baseline;
+}
+
+int main(int argc, char* argv[])
+{
+    string baseline_file, filter;
+    double threshold = 10;
+    bool nogl = false;
+    for(int i=1;i<argc;i++) {
+        const string opt = argv[i];
+        const bool arg = i+1 < argc;
+        if(opt == "--nogl")                   nogl = true;
+        else if(opt == "--baseline" && arg)   baseline_file = argv[++i];
+        else if(opt == "--threshold" && arg)  threshold = atof(argv[++i]);
+        else if(opt == "--filter" && arg)     filter = argv[++i];
+        else {
+            cerr << "Usage: PiGLET_microbench [--baseline file] [--threshold percent] [--filter name] [--nogl]" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    map<string, double> baseline;
+    if(!baseline_file.empty())
+        baseline = ReadBaseline(baseline_file);
+
+    // no IOC is contacted
+    setenv("EPICS_CA_AUTO_ADDR_LIST", "NO", 1);
+    setenv("EPICS_CA_ADDR_LIST", "", 1);
+
+    srand(42);
+    vector<Benchmark*> benchmarks;
+    benchmarks.push_back(new BenchBlockListAdd("BlockList::Add", false));
+    benchmarks.push_back(new BenchBlockListAdd("BlockList::Add/ramp", true));
+    benchmarks.push_back(new BenchFormatNumberSI());
+    benchmarks.push_back(new BenchRoundX());
+    benchmarks.push_back(new BenchUpdateTicks());
+    benchmarks.push_back(new BenchProcessNewData());
+
+    cout << "# benchmark\tns_per_op\tops" << (baseline.empty() ? "" : "\tbaseline_ns\tchange_pct") << endl;
+    bool regression = false;
+    for(size_t b=0;b<benchmarks.size();b++) {
+        Benchmark* bench = benchmarks[b];
+        if(!filter.empty() && bench->name.find(filter) == string::npos)
+            continue;
+        if(nogl && bench->gl)
+            continue;
+
+        bench->Setup();
+        vector<double> ns(REPETITIONS);
+        size_t ops = 0;
+        for(size_t r=0;r<ns.size();r++) {
+            const double t = bench->Run(ops);
+            ns[r] = 1e9 * t / ops;
+        }
+        sort(ns.begin(), ns.end());
+        const double median = ns[ns.size()/2];
+
+        cout << bench->name << "\t" << median << "\t" << ops;
+        map<string, double>::const_iterator it = baseline.find(bench->name);
+        if(it != baseline.end() && it->second > 0) {
+            const double change = 100 * (median - it->second) / it->second;
+            cout << "\t" << it->second << "\t" << change;
+            if(change > threshold)
+                regression = true;
+        }
+        cout << endl;
+    }
+
+    for(size_t b=0;b<benchmarks.size();b++)
+        delete benchmarks[b];
+
+    // the singletons are torn down without waiting for the telnet thread
+    exit(regression ? 1 : EXIT_SUCCESS);
+}
@@ -1,5 +1,11 @@
+# render offscreen with EGL (e.g. Mesa's llvmpipe),
+# for servers without any display
+option(BUILD_HEADLESS "Render into an offscreen pbuffer instead of a window" OFF)
+
 # by default, we build for "normal" environments
-if(NOT DEFINED BUILD_FOR_PI)
+if(BUILD_HEADLESS)
+  set(BUILD_FOR_PI "OFF" CACHE INTERNAL "")
+elseif(NOT DEFINED BUILD_FOR_PI)
   message(STATUS "Detecting architecture...")
   find_file(BCM_HOST_H bcm_host.h HINTS /opt/vc/include)
   if(BCM_HOST_H)
@@ -21,6 +27,18 @@ if(BUILD_FOR_PI)
   link_directories(/opt/vc/lib)
   set(ARCH_LIBS EGL GLESv2 bcm_host)
   add_definitions(-DBUILD_PI)
+elseif(BUILD_HEADLESS)
+  message(STATUS "Building headless. We use EGL pbuffers.")
+  set(ARCH_DIR ${CMAKE_SOURCE_DIR}/arch/Headless)
+
+  find_package(OpenGL REQUIRED)
+  find_library(EGL_LIB EGL)
+  if(NOT EGL_LIB)
+    message(FATAL_ERROR "libEGL is needed for the headless build")
+  endif()
+  include_directories(${OPENGL_INCLUDE_DIR})
+  set(ARCH_LIBS ${OPENGL_LIBRARIES} ${EGL_LIB})
+  add_definitions(-DBUILD_HEADLESS)
 else()
   set(ARCH_DIR ${CMAKE_SOURCE_DIR}/arch/GLUT)
 
@@ -35,3 +53,12 @@ endif()
 # and set the include dir already here
 include_directories(${ARCH_DIR} arch) # add arch dir for arch_common.h
 aux_source_directory(${ARCH_DIR} ARCH_SRC_LIST)
+
+# the shader pipeline (GLES2, or OpenGL 2.1 with GLUT) 
+# replaces the fixed-function one
+option(USE_GLES2 "Render with shaders instead of the fixed-function pipeline" OFF)
+if(USE_GLES2)
+  message(STATUS "Using the shader pipeline.")
+  add_definitions(-DUSE_GLES2)
+  list(APPEND ARCH_SRC_LIST ${CMAKE_SOURCE_DIR}/arch/ShaderCompat.cpp)
+endif()
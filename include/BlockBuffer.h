@@ -2,76 +2,232 @@
 #define BLOCKBUFFER_H
 
 #include <vector>
-#include <list>
+#include <deque>
+#include <cstddef>
 
 #include "Structs.h"
 #include "Interval.h"
 #include "GLTools.h"
 
-#define DATA_BLOCK_SIZE 1
+// initial and maximum number of vertices per trace,
+// both must be powers of two
+#define BLOCKLIST_MIN_VERTICES  1024
+#define BLOCKLIST_MAX_VERTICES  (1<<18)
+
+// level-of-detail pyramid: each level reduces chunks of
+// BLOCKLIST_LOD_CHUNK vertices of the finer level to their min/max pair
+#define BLOCKLIST_LOD_LEVELS    8
+#define BLOCKLIST_LOD_CHUNK     8
+
+// vertices are stored as floats relative to an origin, which
+// is moved if the time is further away from it than this (in seconds)
+#define BLOCKLIST_REBASE_TIME   1024.0
+
+
+/**
+ * @brief Preallocated ring buffer of vertices
+ *
+ * Every vertex is stored twice (at n and n+Capacity()), so any range of
+ * consecutive vertices is contiguous in memory and can be drawn with
+ * a single glDrawArrays call, even if it wraps around the ring.
+ * Vertices are addressed by absolute (ever increasing) indices.
+ * The capacity only grows (doubling up to the given maximum), so there
+ * is no allocation in the steady state. If the ring is full at its maximum,
+ * the oldest vertex is dropped.
+ * The ring is mirrored in a GL buffer object, to which only the vertices
+ * added since the last Draw() are uploaded.
+ */
+class VertexRing {
+protected:
+    std::vector<vec2_t> _data;
+    size_t _mask;   // Capacity()-1
+    size_t _max;    // maximum capacity
+    size_t _head;   // absolute index of the next vertex to be added
+    size_t _tail;   // absolute index of the oldest vertex
 
+    // absolute indices where a new, unconnected segment starts
+    std::deque<size_t> _breaks;
 
+    mutable VertexBuffer _vbo;
+    mutable size_t _uploaded; // absolute index up to which _vbo is up-to-date
+    mutable bool _stale;      // _vbo needs a complete upload
 
-class Block {
-protected:
-    Interval _xrange;
-    Interval _yrange;
+    void Grow();
+    void PruneBreaks();
+    void Sync() const;
+    void UploadRange( const size_t start, const size_t end ) const;
+    void DrawRange( const size_t start, const size_t end ) const;
 
 public:
+    VertexRing( const size_t capacity=BLOCKLIST_MIN_VERTICES,
+                const size_t max=BLOCKLIST_MAX_VERTICES );
+    virtual ~VertexRing() {}
 
-    Block(): _xrange(), _yrange() {}
-    virtual ~Block() {}
+    size_t Size() const { return _head - _tail; }
+    size_t Capacity() const { return _mask + 1; }
+    bool Empty() const { return _head == _tail; }
 
-    const Interval& XRange() const { return _xrange; }
-    const Interval& YRange() const { return _yrange; }
+    size_t Head() const { return _head; }
+    size_t Tail() const { return _tail; }
 
-    virtual void Draw() const =0;
+    const vec2_t& at( const size_t n ) const { return _data[n & _mask]; }
+    const vec2_t& Oldest() const { return at(_tail); }
+    const vec2_t& Newest() const { return at(_head-1); }
 
-    virtual bool isFull() const { return true; }
+    void Add( const vec2_t& vertex );
+    void PopOldest();
+
+    /**
+     * @brief Move all vertices by dx
+     */
+    void Shift( const float dx );
+
+    /**
+     * @brief Don't connect the next added vertex to the previous one
+     */
+    void Break();
+
+    /**
+     * @brief true if the next added vertex starts a new segment
+     */
+    bool Broken() const { return !_breaks.empty() && _breaks.back() == _head; }
+
+    /**
+     * @brief Draw all segments, one GL_LINE_STRIP each
+     */
+    void Draw() const;
+};
 
-    virtual void Add( const vec2_t& vertex ) =0;
 
-    virtual const vec2_t& LastValue() const =0;
+/**
+ * @brief Sliding window minimum and maximum
+ *
+ * Keeps two monotonic deques of (index, value) pairs, so adding a value
+ * and expiring old ones is amortized O(1), independent of the window size.
+ * Values must be added with increasing indices, NaNs are ignored.
+ */
+class MinMaxWindow {
+protected:
+    typedef struct {
+        size_t n;
+        float  y;
+    } entry_t;
+
+    // ring of entries, grows on demand
+    class Deque {
+    private:
+        std::vector<entry_t> _data;
+        size_t _mask;
+        size_t _head;
+        size_t _tail;
+
+        void Grow();
+
+    public:
+        Deque( const size_t capacity );
+
+        bool Empty() const { return _head == _tail; }
+        const entry_t& Front() const { return _data[_tail & _mask]; }
+        const entry_t& Back() const { return _data[(_head-1) & _mask]; }
+
+        void PushBack( const entry_t& e );
+        void PopBack() { --_head; }
+        void PopFront() { ++_tail; }
+        void Clear() { _tail = _head; }
+    };
+
+    Deque _min;  // increasing values
+    Deque _max;  // decreasing values
+
+public:
+    MinMaxWindow( const size_t capacity=BLOCKLIST_MIN_VERTICES );
 
+    void Add( const size_t n, const float y );
+
+    /**
+     * @brief Forget all values with index before tail
+     */
+    void Expire( const size_t tail );
+
+    void Clear() { _min.Clear(); _max.Clear(); }
+
+    /**
+     * @brief The range of the current window, NaN if empty
+     */
+    Interval Range() const;
 };
 
-class DataBlock: public Block {
+
+/**
+ * @brief Multi-resolution min/max representation of a trace
+ *
+ * Built incrementally: Each level collects BLOCKLIST_LOD_CHUNK vertices of
+ * the next finer level and reduces them to the vertices with the
+ * minimum and maximum y (in time order), so spikes are preserved.
+ * The not yet reduced vertices of all finer levels are drawn after the
+ * level's own vertices, such that the newest data is always shown.
+ */
+class LODPyramid {
 protected:
-    std::vector<vec2_t> _data;
-    size_t _size;
+    class Level {
+    public:
+        VertexRing ring;
+        std::vector<vec2_t> pending; // newest vertices of the finer level
 
-public:
-    DataBlock( const unsigned int size=DATA_BLOCK_SIZE ): _size(size) { _data.reserve(size);}
-    virtual ~DataBlock() {}
+        Level( const size_t capacity, const size_t max ): ring(capacity, max) {
+            pending.reserve(BLOCKLIST_LOD_CHUNK);
+        }
+    };
+
+    std::vector<Level*> _levels;
+
+    // pending vertices of a level and its finer ones, see Draw()
+    mutable std::vector<vec2_t> _tail;
+
+    void Feed( const size_t level, const vec2_t& vertex );
+    void Reduce( const size_t level );
 
-    virtual void Draw() const;
+    // forbid copying
+    LODPyramid(LODPyramid const& copy);            // Not Implemented
+    LODPyramid& operator=(LODPyramid const& copy); // Not Implemented
 
-    virtual void Add( const vec2_t& vertex );
+public:
+    LODPyramid();
+    virtual ~LODPyramid();
+
+    size_t Levels() const { return _levels.size(); }
 
-    inline size_t Size() const { return _data.size(); }
+    /**
+     * @brief Approximate number of vertices drawn at the given level
+     */
+    size_t Size( const size_t level ) const { return _levels[level]->ring.Size(); }
 
-    virtual vec2_t& at( const unsigned int n ) { return _data.at(n); }
-    virtual const vec2_t& at( const unsigned int n ) const { return _data.at(n); }
+    void Add( const vec2_t& vertex );
+    void Break();
 
-    virtual bool isFull() const { return _data.size() >= _size; }
+    /**
+     * @brief Remove vertices which are out of range
+     * @param xmin lower bound of the visible x range
+     */
+    void Expire( const float xmin );
 
-     virtual const vec2_t& LastValue() const { return _data.back(); }
+    void Shift( const float dx );
 
+    void Draw( const size_t level ) const;
 };
 
 
 class BlockList {
 protected:
-    typedef std::list<Block*> blist;
-    blist _blocks;
+    VertexRing _ring;
+    MinMaxWindow _window;
+    LODPyramid _lod;
     float _backlen;
+    double _origin; // absolute time the vertices are relative to
     Interval _xrange;
     Interval _yrange;
 
-    void BuildYRange();
-
-    void PopBack();
-
+    void Rebase( const double x );
 
 public:
     Color color;
@@ -79,21 +235,40 @@ public:
     BlockList( const float backlen=1.0f );
     virtual ~BlockList();
 
+    /**
+     * @brief The visible x range, relative to the origin
+     */
     const Interval& XRange() const { return _xrange; }
     const Interval& YRange() const { return _yrange; }
 
-    void Add( const vec2_t& vertex );
+    /**
+     * @brief Convert a sample to the coordinates used for drawing
+     */
+    vec2_t ToVertex( const dvec2_t& sample ) const;
 
-    void Draw() const;
+    void Add( const dvec2_t& sample );
 
-    void SetNow( const float now );
-    void SetBackLength( const float len ) { _backlen = len; 
+    /**
+     * @brief Draw the trace
+     * @param xpixels width of the plot in pixels. A coarser level of detail
+     *        is chosen to draw at most about 2 vertices per pixel.
+     *        If zero, all vertices are drawn.
+     */
+    void Draw( const float xpixels=0 ) const;
+
+    void SetNow( const double now );
+    void SetBackLength( const float len ) { _backlen = len;
                                             _xrange.Min() = _xrange.Max()-len; }
     const float& GetBackLength () { return _backlen; }
     //void SetYRange( const Interval& yrange ) { _yrange = yrange; }
 
+    /**
+     * @brief Start a new block
+     * @param copy_last if false, the next vertex is not connected
+     *        with a line to the previous one (creates a gap)
+     */
     void NewBlock(const bool copy_last=true);
-    
+
 };
 
 
@@ -26,7 +26,7 @@ public:
     void MutexLock();
     void MutexUnlock();
     
-    void ExecutePendingCallback();
+    bool ExecutePendingCallback();
     
     // access to the singleton instance
     static ConfigManager& I() {
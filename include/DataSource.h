@@ -0,0 +1,34 @@
+#ifndef DATASOURCE_H
+#define DATASOURCE_H
+
+#include <string>
+#include "Epics.h"
+
+/**
+ * @brief Producer of PV updates other than Channel Access
+ *
+ * Registered with Epics::AddSource() for a prefix of the PV names.
+ * A source feeds its PVs with the Epics::Inject*() calls, from one thread.
+ */
+class DataSource {
+public:
+    virtual ~DataSource() {}
+
+    /**
+     * @brief Start feeding the PV, called when its first consumer is added
+     * @return false if the name is not understood, the PV stays disconnected
+     */
+    virtual bool Subscribe( const std::string& pvname, Epics::Producer p ) = 0;
+
+    /**
+     * @brief Send the properties and the last value again, for a new consumer
+     */
+    virtual void Refresh( Epics::Producer p ) = 0;
+
+    /**
+     * @brief Stop feeding the PV, no Inject*() may be in progress on return
+     */
+    virtual void Unsubscribe( Epics::Producer p ) = 0;
+};
+
+#endif // DATASOURCE_H
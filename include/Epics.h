@@ -4,12 +4,27 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <pthread.h>
 #include <cadef.h>
 #include "Callback.h"
 #include "StopWatch.h"
+#include "Structs.h"
+#include "MemoryPool.h"
+#include "WaveformBuffer.h"
+#include "PVLog.h"
+
+// number of DataItems queued per PV, must be a power of two
+#define EPICS_QUEUE_SIZE      2048
+// slots of the queue which NewValue items may not use,
+// so that connection and property changes never get lost
+#define EPICS_QUEUE_RESERVED  64
+// number of blocks in the pool for the property payloads
+#define EPICS_POOL_BLOCKS     512
 
 using util::Callback; // Callback lives in the util namespace
 
+class DataSource;
+
 class Epics  {
     
 public:   
@@ -18,22 +33,85 @@ public:
         Connected,
         Disconnected,
         NewValue,
-        NewProperties
+        NewProperties,
+        NewWaveform
     } DataType;
     
        
     typedef struct DataItem {
         DataType type;
-        void* data;
-        std::string attr; // if type==NewProperties, this contains what property is in data 
-        struct DataItem* prev;
+        dvec2_t value;     // if type==NewValue: timestamp and value
+                           // if type==NewWaveform: timestamp and number of elements
+        short severity;    // if type==NewValue: alarm severity of the value
+        void* data;        // if type==NewProperties: copy of the dbr (from the pool)
+        const char* attr;  // if type==NewProperties, this contains what property is in data 
     } DataItem;
         
     typedef Callback<void (const DataItem* i)> EpicsCallback;
     
-    void addPV(const std::string& pvname, EpicsCallback cb, bool autoCall = false); // returns the tail of the datalist
-    void removePV(const std::string& pvname);
-    void processNewDataForPV(const std::string& pvname);
+    // one consumer of a PV, see addPV()
+    struct Consumer;
+    typedef Consumer* Subscription;
+    
+    /**
+     * @brief Register a consumer of the PV
+     * 
+     * The PV is subscribed only once, no matter how many consumers it has.
+     * A consumer added later on receives the current connection state, 
+     * value and properties as well.
+     * @param autoCall if true, the cb is called immediately from the EPICS thread,
+     *        otherwise by processNewDataForPV()
+     * @param waveform if given, the PV is subscribed with its native element count 
+     *        and the arrays are written to it. The cb receives NewWaveform items instead
+     *        of NewValue items then.
+     * @return the handle for removePV() and processNewDataForPV()
+     */
+    Subscription addPV(const std::string& pvname, EpicsCallback cb, bool autoCall = false,
+                       WaveformBuffer* waveform = NULL);
+    void removePV(Subscription s);
+    void processNewDataForPV(Subscription s);
+    
+    /**
+     * @brief Limit the updates a consumer is interested in
+     * 
+     * Each consumer applies its own filter to the values it reads, 
+     * the updates which no consumer wants are discarded in the EPICS callback already. 
+     * Changes of the severity always pass. The latest value skipped because of
+     * the interval is delivered once the interval is over, so the last change
+     * of a PV is always seen (unless it's within the deadband).
+     * @param min_interval minimum time between two updates in seconds
+     * @param deadband minimum absolute change of the value
+     * @param deadband_rel minimum change of the value relative to the previous one
+     */
+    void SetFilter(Subscription s, double min_interval, double deadband, double deadband_rel);
+    
+    /**
+     * @brief Choose how the properties of PVs added afterwards are obtained
+     * @param ctrl if true, one DBR_CTRL_DOUBLE subscription (with DBE_PROPERTY)
+     *        on the value channel is used, and the severity is taken from 
+     *        the value's status. Otherwise, a channel for each field is created.
+     */
+    void SetCtrlMode(const bool ctrl) { _ctrl_mode = ctrl; }
+    bool GetCtrlMode() const { return _ctrl_mode; }
+    
+    /**
+     * @brief Serve the scalar PVs starting with prefix by the source instead of CA
+     * 
+     * Takes the ownership. Only PVs added afterwards are affected, the longest
+     * matching prefix wins. The simulated source is always there, see SimulatedSource.
+     * @return false if the prefix is taken already, the source is deleted then
+     */
+    bool AddSource(const std::string& prefix, DataSource* source);
+    
+    /**
+     * @brief Write all updates of the PVs to a log, see PVLog.h
+     * 
+     * The updates are recorded as they arrive, before the filters
+     * and even if the queue is full, so a replay has the original rate.
+     * Waveform PVs are not recorded.
+     * @param filename if empty, the recording is stopped
+     */
+    bool Record(const std::string& filename);
     
     // Implement a singleton
     static Epics& I() {
@@ -48,8 +126,13 @@ public:
     // timestamps given to the
     // epics callbacks
     double GetCurrentTime();   
+
+    // wall-clock time (seconds since 1970)
+    // GetCurrentTime() is relative to
+    double GetStartTime() const;
     
-    
+    // statistics about the property payloads
+    const MemoryPool& Pool() const { return _pool; }
     
 private:
     
@@ -61,43 +144,183 @@ private:
     Epics(Epics const& copy);            // Not Implemented
     Epics& operator=(Epics const& copy); // Not Implemented
     
+    struct PV;
+    
+    // see SetFilter()
+    typedef struct Filter {
+        double min_interval;
+        double deadband;
+        double deadband_rel;
+    } Filter;
+    
+    // what the producer needs to know about a consumer, 
+    // copied so that the consumer can change it anytime
+    typedef struct Reader {
+        Consumer* c;
+        Filter filter;
+        bool auto_call;
+    } Reader;
+    typedef std::vector<Reader> ReaderList;
+    
     typedef struct PV_channel_t {
         chid _chid;
         evid _evid;
+        evid _evid_ctrl; // the DBR_CTRL_DOUBLE subscription, if any
         std::string _attr;
+        struct PV* _pv; // the channel is the user pointer of the EPICS callbacks
     } PV_channel_t;
     
+    // The DataItems are passed from the EPICS callbacks to processNewDataForPV()
+    // via a lock-free ring buffer with one producer and a read cursor per consumer.
+    // All channels of a PV are served by the same IOC, so their callbacks
+    // are delivered by one CA thread.
     typedef struct PV {
+        std::string name;
         std::vector< PV_channel_t > channels;
-        EpicsCallback cb; // gets called by processNewDataForPV() if there is new data
-        bool auto_call;  // if an EPICS callback was received, the events will be processed immediately
-        DataItem* head_last; // remember the last head since processing        
-        DataItem* head; // accessed by EPICS callbacks, one data stream per PV
+        std::vector< Consumer* > consumers; // guarded by mutex
+        pthread_mutex_t mutex;   // only for changing the consumers
+        ReaderList* readers;     // copy of the consumers for the producer, see publishReaders()
+        volatile int reading;    // the producer uses the readers, see beginRead()
+        bool ctrl;       // properties are obtained via DBR_CTRL_DOUBLE, see SetCtrlMode()
+        bool waveform;   // the value is an array, see Consumer::waveform
+        DataSource* source; // if not NULL, it feeds the PV instead of the channels
+        volatile bool connected; // last connection state appended, for sources
+        short severity;  // last severity seen by the producer in ctrl mode
+        bool passed;     // the following describe the last update which passed the filter,
+                         // passed is reset by refresh(), so it's accessed atomically
+        double passed_time;
+        double passed_value;
+        short passed_severity;
+        DataItem held;   // the latest value discarded by the filter
+        size_t held_at;  // head at the time it was discarded
+        volatile size_t held_seq; // counts the discarded values twice, odd while writing held
+        DataItem* queue; // EPICS_QUEUE_SIZE items
+        volatile size_t head; // next item to be written, only modified by the producer
+        size_t reclaimed;     // items before have been deleted, only used by the producer
+        volatile size_t dropped; // number of items not queued since the queue was full
     } PV;
     
-    static PV* initPV();
+    static PV* initPV(const std::string& pvname);
+    static void releasePV(PV* pv);
     
-    // Storage for channels/subscriptions
+    // Storage for channels/subscriptions, 
+    // one per PV name (and kind) shared by all its consumers
     std::map<std::string, PV*> pvs;
+    static std::string key(const std::string& pvname, bool waveform);
     
     epicsTime t0;
     StopWatch _watch;
     
+    // the property payloads are allocated by the CA threads
+    // and freed by the consumer, so we pool them
+    MemoryPool _pool;
+    static size_t propertySize();
+    
+    bool _ctrl_mode;
+    std::string callbackSetMetadata(const std::string& arg);
     
-    static void processNewDataForPV(PV* pv);
+    PVLogWriter _recorder;
+    std::string callbackRecord(const std::string& arg);
+    
+    // serves the PVs which were there when it was started
+    DataSource* _replay;
+    std::string callbackReplay(const std::string& arg);
+    void stopReplay();
+    // hand the PV over to another producer, NULL for CA
+    static void changeSource(PV* pv, DataSource* source);
+    
+    // by prefix of the PV names
+    std::map<std::string, DataSource*> _sources;
+    DataSource* findSource(const std::string& pvname) const;
+    static bool isConnected(const PV* pv);
+    
+    
+    // replace the readers by the current consumers, returns once the 
+    // producer doesn't use the previous ones anymore. The caller must hold the mutex
+    static void publishReaders(PV* pv);
+    // the producer's view of the consumers, without locking, not nested
+    static const ReaderList& beginRead(PV* pv);
+    static void endRead(PV* pv);
+    
+    // the oldest item which is still needed by one of the readers
+    static size_t oldestItem(const PV* pv, const ReaderList& readers);
+    // true if the update at t with value y is of no interest,
+    // compared to the one at last_t with value last_y
+    static bool skip(const Filter& f, double last_t, double last_y,
+                     double t, double y, bool waveform);
+    // true if no consumer wants the update, see SetFilter()
+    static bool filter(PV* pv, double t, double y, short severity);
+    // true if the consumer doesn't want the value now, it's held back then
+    static bool filterConsumer(Consumer* c, const DataItem* i);
+    static void processConsumer(Consumer* c);
     
     static void connectionCallback( connection_handler_args args );
     static void eventCallback( event_handler_args args );
     static void exceptionCallback( exception_handler_args args );
-    static void appendToList(PV* pv, DataItem* pNew);
+    
+    // reserve the next free item of the queue,
+    // returns NULL (and counts the drop) if it's full
+    static DataItem* beginAppend(PV* pv, DataType type);
+    static void endAppend(PV* pv);
+    // writes the update to the log, if recording
+    static void record(PV* pv, DataType type, double x = 0, double y = 0, short severity = 0,
+                       const char* attr = NULL, const void* data = NULL, size_t nBytes = 0);
+    static void appendProperty(PV* pv, const char* attr, const void* data, size_t nBytes);
+    static void appendCtrl(PV* pv, const dbr_ctrl_double* dbr);
     
     static void subscribe(const std::string &pvname, PV* pv);   
-    static void subscribe_channel(const std::string &pvname, PV* pv, 
-                                  const std::string &attr, chtype type ); 
+    // stop the producer, waits for the updates in progress
+    static void unsubscribe(PV* pv);
+    static void refresh(PV* pv);
+    static void subscribe_channel(const std::string &pvname, PV_channel_t& channel, 
+                                  const std::string &attr, chtype type,
+                                  unsigned long count = 1); 
 
     static void deleteDataItem(DataItem* i);
-    static void fillList(DataItem* head, std::vector<DataItem*>& list);   
-        
+    
+public:
+    
+    // the producer side of a PV, see Inject*()
+    typedef PV* Producer;
+    
+    /**
+     * @brief Find a PV to feed it without Channel Access, e.g. for benchmarks
+     * 
+     * The Inject*() calls append to the PV's queue as the EPICS callbacks do,
+     * so they must not be mixed with updates from an IOC. Only one thread
+     * may inject into a PV.
+     * @return NULL if no consumer has added the (scalar) PV
+     */
+    Producer findProducer(const std::string& pvname);
+    void InjectConnection(Producer p, bool connected);
+    // t is relative to GetCurrentTime(), the filters apply
+    void InjectValue(Producer p, double t, double value, short severity = 0);
+    // the attr must stay valid, e.g. a string literal
+    void InjectProperty(Producer p, const char* attr, const void* data, size_t nBytes);
+    
+    // number of items not queued since the queue of the PV was full
+    size_t Dropped(Producer p) const { return __atomic_load_n(&p->dropped, __ATOMIC_RELAXED); }
+    // number of items not yet processed by all consumers
+    size_t Pending(Producer p) const;
+};
+
+struct Epics::Consumer {
+    PV* pv;
+    EpicsCallback cb; // gets called by processNewDataForPV() if there is new data
+    bool auto_call;   // if an EPICS callback was received, the events will be processed immediately
+    bool joined;      // the connection state still has to be told
+    WaveformBuffer* waveform; // receives the arrays of a waveform PV
+    Filter filter;            // see Epics::SetFilter()
+    bool passed;              // the following describe the last value passed to cb
+    double passed_time;
+    double passed_value;
+    short passed_severity;
+    bool holding;             // the latest value held back by the filter
+    DataItem held;
+    size_t held_seq;          // the last value discarded by the producer which was looked at
+    volatile size_t tail; // next item to be read, only modified by the consumer
+    size_t dropped_reported; // the consumer reports the dropped items now and then
+    double dropped_time;
 };
 
 
@@ -0,0 +1,65 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <string>
+
+/**
+ * @brief Paces the main loop to a target frame rate
+ *
+ * The arch calls BeginFrame() before drawing and EndFrame() after
+ * swapping, which returns the time to sleep until the next frame is due.
+ * If nothing was drawn for a while, the loop slows down to the idle rate.
+ * The time spent per drawn frame is compared to the budget 1/fps.
+ */
+class FrameScheduler {
+private:
+    double _target_fps;
+    double _idle_fps;
+
+    double _start;          // of the scheduler, for Time()
+    double _frame_start;    // of the current frame
+    double _next;           // when the next frame is due
+    unsigned int _undrawn;  // frames in a row without drawing
+
+    // statistics since the last report
+    double _report_start;
+    unsigned int _frames;
+    unsigned int _drawn;
+    unsigned int _over_budget;
+    double _sum_frame_time;
+    double _max_frame_time;
+
+    static double Now();
+
+public:
+    FrameScheduler();
+    virtual ~FrameScheduler() {}
+
+    void Start();
+
+    /**
+     * @brief Seconds since Start(), taken at the beginning of the current frame
+     */
+    double Time() const { return _frame_start - _start; }
+
+    void BeginFrame();
+
+    /**
+     * @brief Account the frame which began last
+     * @param drawn if something was drawn (and swapped)
+     * @return seconds to wait until the next frame, zero if late already
+     */
+    double EndFrame( const bool drawn );
+
+    double TargetFPS() const { return _target_fps; }
+    double IdleFPS() const { return _idle_fps; }
+    void SetTargetFPS( const double fps ) { _target_fps = fps; }
+    void SetIdleFPS( const double fps ) { _idle_fps = fps; }
+
+    /**
+     * @brief Frame rate and frame times since the last call
+     */
+    std::string Report();
+};
+
+#endif // FRAMESCHEDULER_H
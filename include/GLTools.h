@@ -1,6 +1,7 @@
 ﻿#ifndef GLTOOLS_H
 #define GLTOOLS_H
 #include "arch.h"
+#include <cstddef>
 #include "Structs.h"
 
 class Vector2 {
@@ -51,6 +52,12 @@ public:
 
     void Activate() const { glColor4fv( _color ); }
 
+    bool operator==( const Color& c ) const {
+        return _color[0] == c._color[0] && _color[1] == c._color[1]
+            && _color[2] == c._color[2] && _color[3] == c._color[3];
+    }
+    bool operator!=( const Color& c ) const { return !(*this == c); }
+
     static const Color Interpolate(const double r, const Color& c0, const Color& c1) {
         const Color c(c0.Red()*(1-r)   + c1.Red()*r,
                 c0.Green()*(1-r) + c1.Green()*r,
@@ -91,14 +98,66 @@ public:
 #define dInvalidAlarm kPink
 
 
+/**
+ * @brief Vertices in a GL buffer object
+ *
+ * The buffer object is created on first use, so instances may exist
+ * before the GL context (e.g. as static members). Drawing leaves
+ * no buffer bound, so client-side arrays keep working elsewhere.
+ */
+class VertexBuffer {
+private:
+    GLuint _vbo;
+    size_t _size;   // in vertices
+
+    void Bind();
+
+    // forbid copying
+    VertexBuffer(VertexBuffer const& copy);            // Not Implemented
+    VertexBuffer& operator=(VertexBuffer const& copy); // Not Implemented
+
+public:
+    VertexBuffer(): _vbo(0), _size(0) {}
+    virtual ~VertexBuffer();
+
+    size_t Size() const { return _size; }
+
+    /**
+     * @brief (Re-)allocate the buffer, the content is undefined afterwards
+     */
+    void Resize( const size_t n );
+
+    /**
+     * @brief Replace the content, resizes if needed
+     */
+    void Set( const vec2_t* v, const size_t n );
+
+    /**
+     * @brief Overwrite n vertices starting at offset
+     */
+    void Upload( const vec2_t* v, const size_t offset, const size_t n );
+
+    void Draw( const GLenum mode, const size_t first, const size_t n );
+
+    /**
+     * @brief Use the content as texture coordinates for the next Draw()
+     */
+    void TexCoordPointer();
+};
+
+/**
+ * @brief Axis-aligned rectangle
+ *
+ * All rectangles are drawn from one shared buffer holding the unit
+ * square, which is moved and scaled by the modelview matrix.
+ */
 class Rectangle {
 private:
     float _width;
     float _height;
     Vector2 _center;
-    vec2_t _vertices[4];
 
-    void _update_vertices();
+    static VertexBuffer& UnitVertices();
 
 public:
     Rectangle( const float x1, const float y1, const float x2, const float y2 );
@@ -143,6 +202,45 @@ public:
 
 };
 
+/**
+ * @brief Offscreen target to cache drawings in a texture
+ *
+ * The framebuffer object is created on first use. Draw() puts
+ * the cached content into the unit square, as Rectangle::unit.
+ */
+class FrameBuffer {
+private:
+    GLuint _fbo;
+    GLuint _tex;
+    int _width;     // the area drawn into
+    int _height;
+    bool _complete;
+    vec2_t _texcoords[4];
+
+    // forbid copying
+    FrameBuffer(FrameBuffer const& copy);            // Not Implemented
+    FrameBuffer& operator=(FrameBuffer const& copy); // Not Implemented
+
+public:
+    FrameBuffer(): _fbo(0), _tex(0), _width(0), _height(0), _complete(false) {}
+    virtual ~FrameBuffer();
+
+    /**
+     * @brief Redirect drawing into the buffer, which is cleared
+     *
+     * The unit square covers width x height pixels then.
+     * @return false if it's not supported, then nothing is redirected
+     */
+    bool Begin( const int width, const int height );
+
+    /**
+     * @brief Draw to the screen again
+     */
+    void End();
+
+    void Draw() const;
+};
+
 class Texture {
 private:
     GLuint _tex;
@@ -165,6 +263,11 @@ public:
         glBindTexture(GL_TEXTURE_2D, _tex);
     }
 
+    // bind only, for callers providing their own texture coordinates
+    void Bind() const {
+        glBindTexture(GL_TEXTURE_2D, _tex);
+    }
+
     const vec2_t* TextureCoords() const { return _texcoords; }
     float GetAspectRatio() const { return _aspect; }
     float GetMaxU() const { return _texcoords[2].x; }
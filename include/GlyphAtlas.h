@@ -0,0 +1,79 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <string>
+#include <vector>
+#include "arch.h"
+#include "GLTools.h"
+
+#define GLYPHATLAS_CHARS " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~"
+#define GLYPHATLAS_COLUMNS 16
+
+/**
+ * @brief All printable ASCII characters in one texture
+ *
+ * The glyphs are rendered once into a grid of equally sized cells,
+ * the font is monospaced. Needs the GL context, so it's created on first use.
+ */
+class GlyphAtlas {
+private:
+    Texture _texture;
+    float _du;  // size of one cell in texture coordinates
+    float _dv;
+
+    GlyphAtlas();
+
+    // forbid copying
+    GlyphAtlas(GlyphAtlas const& copy);            // Not Implemented
+    GlyphAtlas& operator=(GlyphAtlas const& copy); // Not Implemented
+
+public:
+    static const GlyphAtlas& I();
+
+    /**
+     * @brief Width over height of a glyph cell
+     */
+    float GetAspectRatio() const { return _texture.GetAspectRatio(); }
+
+    /**
+     * @brief Texture coordinates of a glyph
+     * @return false if the character is not in the atlas
+     */
+    bool TexCoords( const char c, vec2_t& top_left, vec2_t& bottom_right ) const;
+
+    void Bind() const { _texture.Bind(); }
+};
+
+/**
+ * @brief Textured quads from the glyph atlas, drawn with one call
+ *
+ * Glyphs are collected in the coordinate system of the owner,
+ * they are uploaded on the next Draw() after they changed.
+ */
+class GlyphBatch {
+private:
+    std::vector<vec2_t> _vertices;
+    std::vector<vec2_t> _texcoords;
+    VertexBuffer _vbo;
+    VertexBuffer _tbo;
+    bool _changed;
+
+public:
+    GlyphBatch(): _changed(false) {}
+
+    void Clear();
+
+    /**
+     * @brief Add one glyph covering the given rectangle
+     */
+    void Add( const char c, const float x1, const float y1, const float x2, const float y2 );
+
+    bool Empty() const { return _vertices.empty(); }
+
+    /**
+     * @brief Draw all glyphs in the current color
+     */
+    void Draw();
+};
+
+#endif // GLYPHATLAS_H
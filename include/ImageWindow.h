@@ -61,7 +61,8 @@ public:
 
     void SetURL(const std::string& url);
     
-    void Update() {}
+    void Poll();
+    void Update() { SetDirty(); }
     void Draw();
     
     int Init();
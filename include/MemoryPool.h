@@ -0,0 +1,60 @@
+#ifndef MEMORYPOOL_H
+#define MEMORYPOOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+/**
+ * @brief Thread-safe pool of fixed-size memory blocks
+ *
+ * All blocks are allocated at once. Requests which are larger than the
+ * block size or don't fit into the pool anymore are served by malloc
+ * and counted as misses. Blocks may be freed by another thread than
+ * the allocating one.
+ */
+class MemoryPool {
+private:
+    char* _memory;      // all blocks
+    size_t _blocksize;
+    size_t _blocks;
+    void* _free;        // singly linked list of free blocks
+    pthread_mutex_t _mutex;
+
+    size_t _hits;
+    size_t _misses;
+    size_t _used;
+    size_t _highwater;
+
+    bool Contains( const void* p ) const;
+
+    // forbid copying
+    MemoryPool(MemoryPool const& copy);            // Not Implemented
+    MemoryPool& operator=(MemoryPool const& copy); // Not Implemented
+
+public:
+    MemoryPool( const size_t blocksize, const size_t blocks );
+    virtual ~MemoryPool();
+
+    void* Alloc( const size_t size );
+    void Free( void* p );
+
+    size_t BlockSize() const { return _blocksize; }
+    size_t Blocks() const { return _blocks; }
+
+    /**
+     * @brief Number of allocations served by the pool
+     */
+    size_t Hits() const { return _hits; }
+
+    /**
+     * @brief Number of allocations served by malloc
+     */
+    size_t Misses() const { return _misses; }
+
+    /**
+     * @brief Maximum number of pool blocks used at the same time
+     */
+    size_t HighWater() const { return _highwater; }
+};
+
+#endif // MEMORYPOOL_H
@@ -4,28 +4,17 @@
 #include "arch.h"
 #include "GLTools.h"
 #include "Widget.h"
+#include "GlyphAtlas.h"
 #include <string>
 
 class NumberLabel: public Widget {
 private:
 
-#define NUMBERLABEL_NUM_TEX 128-32
-#define NUMBERLABEL_CHARS " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~"
+    std::string _text;
 
-    // array of texture handles
-    static Texture* _textures;
-    static vec2_t _texcoords[4];
-    static unsigned int _num_objects;   // Number of instances alive
-
-    /**
-     * @brief Generate textures for all characters we can render
-     */
-    static void _maketextures();
-
-    // aspect ratio of the textures
-    static float _texratio;
-
-    std::vector<GLuint> _digtex;
+    // the glyphs in label coordinates and the aspect they were laid out for
+    mutable GlyphBatch _batch;
+    mutable float _batch_aspect;
 
     Color _color;
     unsigned short _prec;
@@ -36,13 +25,26 @@ private:
 
     UnitBorderBox Box;
     
-    std::string FormatNumberSI(const float& v);
     std::string FormatNumberPrec(const float& v, const char prefix);
 public:
     NumberLabel( const Window* owner );
     virtual ~NumberLabel();
 
     void Draw() const;
+
+    /**
+     * @brief The number with the SI prefix which gives the shortest string,
+     *        as shown by SetNumber()
+     */
+    std::string FormatNumberSI(const float& v);
+
+    /**
+     * @brief Add the glyphs to a batch shared with other labels
+     * @param pos where the center of the label goes
+     * @param scale of the label, 1 fills the unit square in width
+     */
+    void Layout( GlyphBatch& batch, const vec2_t& pos, const float scale ) const;
+
     void SetNumber( const float v );
     void SetString( const std::string& str );
     void SetTime( const float s);
@@ -62,7 +64,7 @@ public:
      * @note  Gets applied at the next call to Set()
      * @see GetDigits()
      */
-    void SetDigits( const unsigned char digits ) { _digits = digits; }
+    void SetDigits( const unsigned char digits ) { _digits = digits; _batch_aspect = 0; }
 
     /**
      * @brief Get the number of digits to align text to
@@ -73,7 +75,7 @@ public:
 
 
     bool GetAlignRight() const { return _align_right; }
-    void SetAlignRight(bool align_right) { _align_right = align_right; }
+    void SetAlignRight(bool align_right) { _align_right = align_right; _batch_aspect = 0; }
 
     void SetDrawBox( const bool box ) { _draw_box = box; }
     bool GetDrawBox() const { return _draw_box; }
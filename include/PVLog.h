@@ -0,0 +1,100 @@
+#ifndef PVLOG_H
+#define PVLOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+// File format of the recorded PV updates, in host byte order:
+//   "PGLTLOG1"                    header
+// followed by the records, appended one after the other:
+//   uint32_t  length              of the following fields
+//   uint8_t   type                Epics::DataType
+//   uint8_t   n, char[n]          PV name
+//   uint8_t   n, char[n]          attribute of a property, n=0 otherwise
+//   int16_t   severity
+//   double    time                Epics::GetCurrentTime() when it arrived
+//   double    x, y                Epics::DataItem::value
+//   char[]    data                the rest, payload of a property
+#define PVLOG_MAGIC "PGLTLOG1"
+
+/**
+ * @brief One record of a PV log
+ */
+struct PVLogRecord {
+    uint8_t type;
+    std::string name;
+    std::string attr;
+    int16_t severity;
+    double time;
+    double x;
+    double y;
+    std::vector<char> data;
+};
+
+/**
+ * @brief Appends records to a PV log, from any thread
+ */
+class PVLogWriter {
+private:
+    FILE* _file;
+    pthread_mutex_t _mutex;
+    std::vector<char> _buffer;  // one record, guarded by the mutex
+
+    // forbid copying
+    PVLogWriter(PVLogWriter const& copy);            // Not Implemented
+    PVLogWriter& operator=(PVLogWriter const& copy); // Not Implemented
+
+public:
+    PVLogWriter();
+    virtual ~PVLogWriter();
+
+    /**
+     * @brief Start a new log, closes the current one
+     * @return false if the file can't be written
+     */
+    bool Open( const std::string& filename );
+    void Close();
+
+    // checked for every update, the file changes anytime
+    bool IsOpen();
+
+    void Write( const PVLogRecord& r ) { Write(r.type, r.name, r.attr.c_str(), r.severity,
+                                               r.time, r.x, r.y,
+                                               r.data.empty() ? NULL : &r.data[0], r.data.size()); }
+    void Write( const uint8_t type, const std::string& name, const char* attr,
+                const int16_t severity, const double time, const double x, const double y,
+                const void* data, const size_t nBytes );
+};
+
+/**
+ * @brief Reads a PV log from the beginning
+ */
+class PVLogReader {
+private:
+    FILE* _file;
+    std::vector<char> _buffer;
+
+    // forbid copying
+    PVLogReader(PVLogReader const& copy);            // Not Implemented
+    PVLogReader& operator=(PVLogReader const& copy); // Not Implemented
+
+public:
+    PVLogReader(): _file(NULL) {}
+    virtual ~PVLogReader();
+
+    /**
+     * @return false if it's not a PV log
+     */
+    bool Open( const std::string& filename );
+
+    /**
+     * @brief Read the next record
+     * @return false at the end, or if the rest is truncated
+     */
+    bool Next( PVLogRecord& r );
+};
+
+#endif // PVLOG_H
@@ -1,5 +1,5 @@
 #include "WindowManager.h"
-#include "StopWatch.h"
+#include "FrameScheduler.h"
 
 class PiGLETApp {
 
@@ -15,19 +15,37 @@ public:
         return instance;
     }
     
-    double GetRoughTime();
+    /**
+     * @brief Seconds since Init(), taken once per frame
+     */
+    double GetRoughTime() const { return _scheduler.Time(); }
 
     void Init();
-    void Draw();
+    /**
+     * @brief Draw the windows which changed
+     * @return false if nothing was drawn, then don't swap
+     */
+    bool Draw();
+
+    /**
+     * @brief Call after swapping (or not) the frame drawn last
+     * @return seconds to wait until the next Draw()
+     */
+    double EndFrame();
+
+    WindowManager& Windows() { return windowman; }
     
 private:
-    PiGLETApp():windowman(){}
+    PiGLETApp():_drawn(false),_next_report(0),windowman(){}
     ~PiGLETApp() {}
     
-    unsigned int frames;
-    double fps; // frames per second 
-    double timeElapsed;
-    StopWatch frames_timer;
+    FrameScheduler _scheduler;
+    bool _drawn;            // by the last Draw()
+    double _next_report;    // of the frame statistics
+
+    std::string callbackSetTargetFPS(const std::string& arg);
+    std::string callbackSetIdleFPS(const std::string& arg);
+    std::string callbackSetSwapInterval(const std::string& arg);
     
     // Singleton: Stop the compiler generating methods of copy the object
     PiGLETApp(PiGLETApp const& copy);            // Not Implemented
@@ -10,6 +10,7 @@
 class PlotWindow: public Window {
 private:
     std::string _pvname; // the EPICS PV name
+    Epics::Subscription _pv;
     std::string _xlabel;
     std::string _ylabel;
     
@@ -19,11 +20,27 @@ private:
     SimpleGraph graph;
     TextLabel text;
 
+    // border, title, axes and alarm levels,
+    // only drawn again if something of it changed
+    FrameBuffer _static_layer;
+    bool _static_valid;
+    void DrawStatic();
+
     int frame;          //for debug
     
     void ProcessEpicsData(const Epics::DataItem *i);
     void ProcessEpicsProperties(const std::string &attr, void *d);
     std::string callbackSetBackLength(const std::string& arg);
+    std::string callbackSetAbsoluteTime(const std::string& arg);
+    
+    // see Epics::SetFilter
+    double _min_interval;
+    double _deadband;
+    double _deadband_rel;
+    std::string callbackSetMinInterval(const std::string& arg);
+    std::string callbackSetDeadband(const std::string& arg);
+    std::string callbackSetDeadbandRel(const std::string& arg);
+    std::string SetFilter(const std::string& arg, double& value);
 
     bool _epics_connected;
 
@@ -41,11 +58,16 @@ public:
             const std::string& xlabel = "Always label your axes",
             const std::string& ylabel = "Always label your axes",
             const float xscale = 1,
-            const float yscale = 1);
+            const float yscale = 1,
+            const std::string& name = "");
 
     virtual ~PlotWindow();
 
+    // seconds of data shown
+    void SetBackLength(const float len) { graph.SetBackLength(len); }
+
 
+    virtual void Poll();
     virtual void Update();
     virtual void Draw();
     virtual int Init();
@@ -0,0 +1,79 @@
+#ifndef REPLAYSOURCE_H
+#define REPLAYSOURCE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <pthread.h>
+#include "DataSource.h"
+#include "PVLog.h"
+
+/**
+ * @brief Feeds the PVs from a log written by Epics' recorder
+ *
+ * The replay starts when the first PV is subscribed. The state of each
+ * PV in the log (connection, properties, last value) is kept, so PVs
+ * subscribed later on start from there, even after the end of the log.
+ * Waveforms are not recorded, so they're never replayed.
+ */
+class ReplaySource: public DataSource {
+private:
+    PVLogReader _log;
+    bool _fast;     // as fast as the consumers take the items, instead of 1x
+
+    // what a new consumer needs to know
+    typedef struct State {
+        bool connected;
+        std::map<std::string, std::vector<char> > properties; // by attribute
+        bool has_value;
+        double time;
+        double value;
+        short severity;
+    } State;
+
+    typedef struct Subscription {
+        Epics::Producer producer;
+        bool refresh;   // the state is injected by the thread
+        bool fresh;     // the connection state as well, the PV doesn't know it yet
+    } Subscription;
+
+    // by PV name, guarded by the mutex
+    std::map<std::string, State> _states;
+    std::map<std::string, Subscription> _pvs;
+    pthread_mutex_t _mutex;
+    pthread_t _thread;
+    bool _started;
+    volatile bool _stop;
+
+    static void* start_thread(void *obj)
+    {
+        reinterpret_cast<ReplaySource*>(obj)->do_work();
+        return NULL;
+    }
+    void do_work();
+
+    // the caller must hold the mutex
+    void Update( State& s, const PVLogRecord& r, const double t );
+    void Inject( Epics::Producer p, const PVLogRecord& r, const double t );
+    void InjectState( Epics::Producer p, const State& s, const bool connect );
+    void Refreshes();
+
+    // forbid copying
+    ReplaySource(ReplaySource const& copy);            // Not Implemented
+    ReplaySource& operator=(ReplaySource const& copy); // Not Implemented
+
+public:
+    ReplaySource( const bool fast );
+    virtual ~ReplaySource();
+
+    /**
+     * @return false if it's not a PV log
+     */
+    bool Open( const std::string& filename ) { return _log.Open(filename); }
+
+    bool Subscribe( const std::string& pvname, Epics::Producer p );
+    void Refresh( Epics::Producer p );
+    void Unsubscribe( Epics::Producer p );
+};
+
+#endif // REPLAYSOURCE_H
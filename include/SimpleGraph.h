@@ -8,12 +8,15 @@
 #include "Interval.h"
 #include "alarm.h"
 #include "StopWatch.h"
-#include <list>
+#include <vector>
 #include <cmath>
 
 #define NTICKSFULLX  6
 #define NTICKSFULLY  5
+#define NTICKSMAX    16 // labels per axis, allocated once
+#define AUTORANGE_SHRINK 0.5 // shrink the autorange only below this fraction
 #define ALARM_DECAY_TIME 10 // seconds after ValueDisplay fades back to dTextColor
+#define TRACE_LINEWIDTH 1.0f // as the alarm levels, independent of the cached static layer
 
 class SimpleGraph: public Widget {
 
@@ -22,24 +25,73 @@ private:
     // ------ Tick System -------
 
     class TickLabel: public NumberLabel {
+    private:
+        double _tick;  // the value the text was formatted for
     public:
         vec2_t position;
 
-        TickLabel(const Window* owner, const vec2_t& pos, const float v , const Color &color = dPlotTickLabels);
+        TickLabel(const Window* owner, const Color &color = dPlotTickLabels);
         virtual ~TickLabel() {}
-        void Draw() const;
+
+        // move the label, the text is only formatted if v changed
+        void PlaceTime( const vec2_t& pos, const float v );
+        void PlaceNumber( const vec2_t& pos, const float v );
+        // v in seconds since 1970, dx is the tick distance
+        void PlaceClock( const vec2_t& pos, const double v, const float dx );
     };
 
-    typedef std::list<TickLabel*> labellist;
-    labellist _labels;
+    typedef std::vector<TickLabel*> labellist;
+
+    /**
+     * @brief Lines and labels of one axis
+     *
+     * The labels come from a pool allocated once. The lines and
+     * the glyphs are uploaded when the ticks change and drawn
+     * with one call each.
+     */
+    class TickAxis {
+    private:
+        labellist _pool;
+        labellist _shown;
+        std::vector<vec2_t> _lines;
+        VertexBuffer _vbo;
+        GlyphBatch _glyphs;
+        float _glyphs_aspect; // window aspect the glyphs were laid out for
+
+    public:
+        TickAxis( const Window* owner );
+        ~TickAxis();
 
-    std::vector<vec2_t> _ticks;
+        void Clear();
+
+        /**
+         * @brief Add a tick line
+         * @param slot the pool label to use, keep it the same to
+         *        avoid formatting the text of a tick again
+         * @return the label to place, NULL if the slot is out of the pool
+         */
+        TickLabel* Add( const vec2_t& from, const vec2_t& to, const size_t slot );
+
+        void Draw( const Color& lines, const Color& labels, const float aspect );
+    };
+
+    TickAxis _xaxis;
+    TickAxis _yaxis;
+
+    // absolute wall-clock time ticks, see SetAbsoluteTime()
+    bool   _absolute_time;
+    double _start_time;
+    double _now;
+    float  _xtick_dx;
+    double _xtick_first;  // index of the first and last
+    double _xtick_last;   // visible wall-clock tick
+    float  _xtick_base;   // ToVertex() of time 0 when generated
 
-    void DeleteTicks();
     float GetXGlobal( const float x);
     float GetYGlobal( const float y);
-    void AddXTick( const float x);
-    void AddYTick( const float y);
+    void UpdateXTicks();
+    void UpdateYTicks();
+    bool XTicksMoved() const;
 
     // -------------------------
 
@@ -53,8 +105,6 @@ private:
     Color _curr_color;
     UnitBorderBox PlotArea;
 
-    static float roundX( float x);
-
     /**
      * @brief The AlarmLevels class
      * @todo This whole solution is crappy... These lines should be drawn
@@ -68,6 +118,7 @@ private:
         Interval _levels;
         Interval _draw_levels;
         std::vector<vec2_t> _lines;
+        VertexBuffer _vbo;
 
     public:
         Color AlarmColor;
@@ -84,7 +135,13 @@ private:
     AlarmLevels _minorAlarm;
     AlarmLevels _majorAlarm;
 
-    vec2_t _lastline[2];
+    dvec2_t _lastline[2];
+
+    float _drawn_scroll;  // x range in pixels when drawn last
+    bool  _static_changed; // see StaticChanged()
+
+    // the wall-clock ticks move with the data
+    void DrawScrollingTicks();
 
     void SetYRange( const Interval& yrange );
     void SetAutoRange( const bool autorange );    
@@ -94,7 +151,7 @@ private:
     
 public:
     Color TickColor;
-    Color TickLabelColor;   //note: does not change color on screen when changed!
+    Color TickLabelColor;
     Color StartLineColor;
 
     bool  enable_lastline;
@@ -102,21 +159,61 @@ public:
     SimpleGraph( Window* owner, const float backlength );
     virtual ~SimpleGraph();
 
-    void AddToBlockList( const vec2_t& p); 
+    void AddToBlockList( const dvec2_t& p); 
 
     void NewBlock();
 
     void UpdateTicks();
 
-    void DrawTicks() const;
+    /**
+     * @brief Round to one significant digit, for the tick spacing
+     */
+    static float roundX( float x);
+
     void Draw();
 
-    void SetNow( const float now ) { 
+    /**
+     * @brief Draw the parts which change rarely: the plot area,
+     *        the alarm levels and the ticks, if they don't scroll
+     */
+    void DrawStatic();
+
+    /**
+     * @brief Draw the trace, the value and the scrolling ticks
+     */
+    void DrawLive();
+
+    /**
+     * @brief Check if the parts drawn by DrawStatic()
+     *        changed since the last call
+     */
+    bool StaticChanged();
+
+    /**
+     * @brief Check if the graph would look different than when
+     *        drawn last, because it scrolled by a pixel or blinks
+     * @note New data must be checked by the caller
+     */
+    bool Damaged();
+
+    void SetNow( const double now ) { 
         if(isnan(now)) 
             return; 
         _blocklist.SetNow(now); 
         _lastline[1].x=now; 
+        _now = now;
     }
+
+    /**
+     * @brief Label the time axis with the wall-clock time
+     *
+     * The ticks then scroll with the data, they are moved by the
+     * modelview matrix and only generated again when one of them
+     * leaves the plot.
+     * @param absolute false for ticks relative to now
+     * @param start wall-clock time (seconds since 1970) of time 0
+     */
+    void SetAbsoluteTime( const bool absolute, const double start=0 );
     void SetBackLength( const float len ) { _blocklist.SetBackLength( len ); UpdateTicks(); }
     void SetYRangeMin( const double val );
     void SetYRangeMax( const double val );
@@ -0,0 +1,93 @@
+#ifndef SIMULATEDSOURCE_H
+#define SIMULATEDSOURCE_H
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "DataSource.h"
+
+#define SIMULATEDSOURCE_PREFIX "sim:"
+
+/**
+ * @brief In-process PVs, for load tests without any IOC
+ *
+ * The PV name describes the signal:
+ *     sim:<pattern>[:<option>=<value>]...
+ * with the patterns sine, noise, step (a square wave) and burst (a sine with
+ * additional bursts of updates) and the options
+ *     rate=10        updates per second
+ *     period=10      seconds, of the sine, the steps or between the bursts
+ *     amp=1          amplitude
+ *     burst=100      updates per burst
+ *     disconnect=0   seconds between connecting and disconnecting, 0 never
+ *     alarms=0       if 1, the alarm limits are at 70% and 90% of the amplitude
+ *                    and the severity follows the value
+ * E.g. sim:sine:rate=1000:alarms=1
+ * The updates are generated by one thread, every millisecond.
+ */
+class SimulatedSource: public DataSource {
+private:
+    typedef enum {
+        Sine,
+        Noise,
+        Step,
+        Burst
+    } Pattern;
+
+    struct Signal {
+        Epics::Producer producer;
+        Pattern pattern;
+        std::string unit;   // the name of the pattern
+        double rate;
+        double period;
+        double amplitude;
+        size_t burst;
+        double disconnect;
+        bool alarms;
+
+        double start;       // time of the subscription
+        size_t updates;     // regular updates sent since start
+        size_t bursts;      // bursts sent since start
+        bool connected;
+        double next_toggle; // of the connection
+        short severity;
+        bool refresh;       // requested by Refresh()
+        bool has_value;
+        double last_time;
+        double last_value;
+        unsigned int seed;  // for rand_r, the thread owns it
+    };
+
+    std::vector<Signal> _signals; // guarded by the mutex
+    pthread_mutex_t _mutex;
+    pthread_t _thread;
+    bool _started;
+    volatile bool _stop;
+
+    static void* start_thread(void *obj)
+    {
+        reinterpret_cast<SimulatedSource*>(obj)->do_work();
+        return NULL;
+    }
+    void do_work();
+
+    static bool Parse( const std::string& pvname, Signal& s );
+    void Tick( Signal& s, const double now );
+    void SendProperties( Signal& s );
+    void SendValue( Signal& s, const double t );
+    double Value( Signal& s, const double t );
+
+    // forbid copying
+    SimulatedSource(SimulatedSource const& copy);            // Not Implemented
+    SimulatedSource& operator=(SimulatedSource const& copy); // Not Implemented
+
+public:
+    SimulatedSource();
+    virtual ~SimulatedSource();
+
+    bool Subscribe( const std::string& pvname, Epics::Producer p );
+    void Refresh( Epics::Producer p );
+    void Unsubscribe( Epics::Producer p );
+};
+
+#endif // SIMULATEDSOURCE_H
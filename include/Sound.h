@@ -43,6 +43,7 @@ private:
     StopWatch _muted;
     double _muted_for;
     const std::string _pvname;
+    Epics::Subscription _pv;
     void ProcessEpicsData(const Epics::DataItem *i);
     
     // This is the static class function that serves as a C style function pointer
@@ -8,4 +8,11 @@ typedef struct {
     GLfloat y;
 } vec2_t;
 
+// samples with absolute timestamps (in seconds) as x,
+// which need more precision than floats can give
+typedef struct {
+    double x;
+    double y;
+} dvec2_t;
+
 #endif // STRUCTS_H
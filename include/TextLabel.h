@@ -5,15 +5,20 @@
 
 #include "Structs.h"
 #include "GLTools.h"
+#include "GlyphAtlas.h"
 #include "Widget.h"
 
 
 class TextLabel: public Widget {
 private:
 
-    Texture      _texture;   // texture handle
+    std::string _text;
     Color       _color;     // color for the text
     Rectangle   _rext;      // Maximum size of the text
+
+    // the glyphs and the window aspect they were laid out for
+    mutable GlyphBatch _batch;
+    mutable float      _batch_aspect;
     
 public:
 
@@ -24,7 +29,7 @@ public:
     void Draw() const;
 
     void SetText( const std::string& text );
-    //const std::string& GetText() const { return _text; }
+    const std::string& GetText() const { return _text; }
     void SetColor( const Color& c ) { _color = c; }
     Color GetColor() const { return _color; }
 };
@@ -48,6 +48,14 @@ public:
     virtual ~TextRenderer();
         
     void Text2Texture( Texture& tex, const std::string &text );
+
+    /**
+     * @brief Render each character into a grid of equal cells
+     * @param columns number of cells per row
+     * @note The max UV of tex cover the whole grid,
+     *       the aspect ratio is the one of a single cell
+     */
+    void Glyphs2Texture( Texture& tex, const std::string &glyphs, const size_t columns );
     void Mw2Texture(Texture &tex);
     bool Image2Mw(const std::string& url, 
                   const size_t& crop_w = 0, const size_t& crop_h = 0, 
@@ -0,0 +1,71 @@
+#ifndef WAVEFORMBUFFER_H
+#define WAVEFORMBUFFER_H
+
+#include <vector>
+#include <cstddef>
+
+#include "Structs.h"
+#include "Interval.h"
+
+/**
+ * @brief Triple-buffered vertex slabs of a waveform
+ *
+ * The EPICS thread converts each received array into the back slab and
+ * publishes it, the render thread picks up the newest published slab and
+ * draws its vertices directly. Handing over whole frames lock-free needs
+ * three slabs: one being written, one ready and one being drawn.
+ * Slabs only grow, so there is no allocation in the steady state.
+ */
+class WaveformBuffer {
+public:
+    class Slab {
+    public:
+        std::vector<vec2_t> vertices; // x is the element index
+        size_t elements;              // number of elements of the waveform
+        Interval yrange;              // of the vertices, NaN if empty
+        double time;
+
+        Slab(): elements(0), yrange(nanf(""),nanf("")), time(0) {}
+    };
+
+private:
+    static const size_t FRESH = 4; // flags a not yet acquired ready slab
+
+    Slab _slabs[3];
+    size_t _back;            // only used by the producer
+    volatile size_t _ready;  // exchanged by both
+    size_t _front;           // only used by the consumer
+
+    volatile size_t _max_vertices;
+
+    // forbid copying
+    WaveformBuffer(WaveformBuffer const& copy);            // Not Implemented
+    WaveformBuffer& operator=(WaveformBuffer const& copy); // Not Implemented
+
+public:
+    WaveformBuffer();
+
+    /**
+     * @brief Convert the values and publish them (producer)
+     *
+     * If there are more values than the maximum number of vertices,
+     * they are reduced to the min/max pair of each of max/2 buckets.
+     */
+    void Write( const double* values, const size_t n, const double time );
+
+    /**
+     * @brief Take the newest published slab as front slab (consumer)
+     * @return true if there was a new one
+     */
+    bool Acquire();
+
+    const Slab& Front() const { return _slabs[_front]; }
+
+    /**
+     * @brief Limit the number of vertices per slab, zero means no decimation
+     */
+    void SetMaxVertices( const size_t max ) { _max_vertices = max; }
+    size_t GetMaxVertices() const { return _max_vertices; }
+};
+
+#endif // WAVEFORMBUFFER_H
@@ -0,0 +1,56 @@
+#ifndef WAVEFORMWINDOW_H
+#define WAVEFORMWINDOW_H
+
+#include "Epics.h"
+#include "Window.h"
+#include "TextLabel.h"
+#include "WaveformBuffer.h"
+
+/**
+ * @brief Displays the latest array of a waveform PV
+ *
+ * The element index is the x axis. The y range covers LOPR/HOPR
+ * and the current array.
+ */
+class WaveformWindow: public Window {
+private:
+    std::string _pvname; // the EPICS PV name
+    Epics::Subscription _pv;
+
+    bool _initialized;
+
+    UnitBorderBox WindowArea;
+    UnitBorderBox PlotArea;
+    TextLabel text;
+
+    WaveformBuffer _buffer;
+    VertexBuffer _vbo;   // the front slab
+    Interval _yrange;    // LOPR and HOPR
+    Color _color;
+    bool _decimate;      // to about two vertices per pixel
+
+    bool _epics_connected;
+
+    TextLabel discon_lbl;
+
+    void ProcessEpicsData(const Epics::DataItem *i);
+    void ProcessEpicsProperties(const std::string &attr, void *d);
+    std::string callbackSetDecimate(const std::string& arg);
+
+public:
+    WaveformWindow(
+            WindowManager* owner,
+            const std::string& pvname,
+            const float xscale = 1,
+            const float yscale = 1,
+            const std::string& name = "");
+
+    virtual ~WaveformWindow();
+
+    virtual void Poll();
+    virtual void Update() { SetDirty(); }
+    virtual void Draw();
+    virtual int Init();
+};
+
+#endif // WAVEFORMWINDOW_H
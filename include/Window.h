@@ -18,6 +18,9 @@ private:
     std::string _name; // unique window name
     float _x_pixels;
     float _y_pixels;   
+    float _x_offset;   // lower left corner on the screen
+    float _y_offset;
+    bool _dirty;       // must be drawn in the next frame
     
     std::string callbackRemoveWindow(const std::string& arg);       
 public:
@@ -34,9 +37,32 @@ public:
     const float& YPixels() const { return _y_pixels; }  
     float& XPixels()  { return _x_pixels; }
     float& YPixels()  { return _y_pixels; }  
+    float& XOffset()  { return _x_offset; }
+    float& YOffset()  { return _y_offset; }
+
+    /**
+     * @brief Restrict drawing to a rectangle via the scissor test
+     * @param x1,y1,x2,y2 corners in window coordinates (-1..1)
+     * @note Disable GL_SCISSOR_TEST when done
+     */
+    void Scissor( const float x1, const float y1, const float x2, const float y2 ) const;
     
     const std::string& Name() const { return _name; }
     
+    /**
+     * @brief Mark the window to be drawn in the next frame
+     */
+    void SetDirty() { _dirty = true; }
+    bool IsDirty() const { return _dirty; }
+    void ClearDirty() { _dirty = false; }
+
+    /**
+     * @brief Called every frame, also if the window is not drawn
+     *
+     * Fetch new data here and call SetDirty() if the content changed.
+     */
+    virtual void Poll() {}
+
     virtual void Update() = 0;
     virtual void Draw() = 0;
     virtual int Init();
@@ -18,10 +18,12 @@ private:
     Texture _tex;
     Color _color;
     TextRenderer _render;
+    bool _damaged;  // the whole screen must be drawn again
 
     std::string callbackRemoveAllWindows(const std::string& arg );
     std::string callbackAddPlotWindow( const std::string& arg );
     std::string callbackAddImageWindow(const std::string &arg);
+    std::string callbackAddWaveformWindow(const std::string &arg);
 
     void alignWindows();    
 public:
@@ -40,7 +42,18 @@ public:
     int RemoveWindow( const size_t n );
     int RemoveWindow( const std::string& name );
     
-    void Draw();
+    /**
+     * @brief Poll all windows and draw the dirty ones
+     * @param preserved if the back buffer still holds the last frame,
+     *        otherwise all windows are drawn if any is dirty
+     * @return false if nothing was drawn
+     */
+    bool Draw( const bool preserved );
+
+    /**
+     * @brief Draw everything in the next frame, e.g. after config changes
+     */
+    void SetDamaged() { _damaged = true; }
 
 
 
@@ -7,130 +7,419 @@
 
 using namespace std;
 
-void DataBlock::Draw() const
+VertexRing::VertexRing( const size_t capacity, const size_t max ):
+    _data(2*capacity),
+    _mask(capacity-1),
+    _max(max),
+    _head(0),
+    _tail(0),
+    _uploaded(0),
+    _stale(true)
 {
-    glVertexPointer(2, GL_FLOAT, 0, _data.data());
-    glDrawArrays(GL_LINE_STRIP, 0, _data.size());
 }
 
-void DataBlock::Add(const vec2_t &vertex)
+void VertexRing::Grow()
 {
-    if( _data.empty() ) {
-
-        _xrange.Min() = vertex.x;
+    const size_t capacity = 2*Capacity();
+    std::vector<vec2_t> data(2*capacity);
+    const size_t mask = capacity-1;
+    for( size_t n=_tail; n != _head; ++n ) {
+        data[n & mask] = at(n);
+        data[(n & mask) + capacity] = at(n);
+    }
+    _data.swap(data);
+    _mask = mask;
+    _stale = true;
+}
 
-        _yrange.Min() = vertex.y;
-        _yrange.Max() = vertex.y;
+void VertexRing::PruneBreaks()
+{
+    // a break is only meaningful if it lies behind the oldest
+    // vertex and not beyond the head (unsigned arithmetic handles wrapping)
+    while( !_breaks.empty() && _breaks.front() - _tail - 1 >= Size() )
+        _breaks.pop_front();
+}
 
-    } else {
-        _yrange.Extend(vertex.y);
+void VertexRing::Add( const vec2_t& vertex )
+{
+    if( Size() == Capacity() ) {
+        if( Capacity() < _max )
+            Grow();
+        else
+            PopOldest();
     }
 
-    _xrange.Max() = vertex.x;
+    const size_t n = _head & _mask;
+    _data[n] = vertex;
+    _data[n + Capacity()] = vertex;
+    ++_head;
+}
 
-    _data.push_back(vertex);
+void VertexRing::PopOldest()
+{
+    if( Empty() )
+        return;
+    ++_tail;
+    PruneBreaks();
+}
 
+void VertexRing::Shift( const float dx )
+{
+    for( size_t n=_tail; n != _head; ++n ) {
+        const size_t i = n & _mask;
+        _data[i].x += dx;
+        _data[i + Capacity()].x += dx;
+    }
+    _stale = true;
 }
 
+void VertexRing::Break()
+{
+    if( Empty() )
+        return;
+    if( !_breaks.empty() && _breaks.back() == _head )
+        return;
+    _breaks.push_back(_head);
+}
 
-void BlockList::BuildYRange()
+void VertexRing::UploadRange( const size_t start, const size_t end ) const
 {
-    _yrange = Interval(nanf(""),nanf(""));
-    blist::const_iterator i;
-    for( i= _blocks.begin(); i != _blocks.end(); ++i )
-        _yrange.Extend( (*i)->YRange() );
+    // both copies of each vertex, in at most two pieces per copy
+    // (the data is mirrored as well, so any source range is contiguous)
+    const size_t cap = Capacity();
+    const size_t a = start & _mask;
+    const size_t n = end - start;
+    const size_t first = a + n > cap ? cap - a : n;
+    _vbo.Upload(&_data[a], a, first);
+    _vbo.Upload(&_data[a], a + cap, first);
+    if( first < n ) {
+        _vbo.Upload(&_data[0], 0, n - first);
+        _vbo.Upload(&_data[0], cap, n - first);
+    }
 }
 
-void BlockList::PopBack()
+void VertexRing::Sync() const
 {
-    if( !_blocks.empty() ) {
-        Block* last = _blocks.back();
-        delete last;
-        _blocks.pop_back();
-        BuildYRange();
+    if( _stale || _vbo.Size() != _data.size()
+        || _head - _uploaded > Capacity() ) {
+        _vbo.Set(&_data[0], _data.size());
+        _stale = false;
     }
+    else if( _uploaded != _head ) {
+        UploadRange(_uploaded, _head);
+    }
+    _uploaded = _head;
 }
 
-void BlockList::NewBlock( const bool copy_last )
+void VertexRing::DrawRange( const size_t start, const size_t end ) const
 {
+    const size_t n = end - start;
+    if( n < 2 )
+        return;
+    _vbo.Draw(GL_LINE_STRIP, start & _mask, n);
+}
 
-    Block* b = new DataBlock();
+void VertexRing::Draw() const
+{
+    Sync();
 
-    if( !_blocks.empty() && copy_last ) {
-        Block* l = _blocks.front();
-        b->Add( l->LastValue() );
+    size_t start = _tail;
+    std::deque<size_t>::const_iterator i;
+    for( i = _breaks.begin(); i != _breaks.end(); ++i ) {
+        DrawRange(start, *i);
+        start = *i;
     }
+    DrawRange(start, _head);
+}
 
-    _blocks.push_front(b);
 
+MinMaxWindow::Deque::Deque( const size_t capacity ):
+    _data(capacity),
+    _mask(capacity-1),
+    _head(0),
+    _tail(0)
+{
 }
 
-BlockList::BlockList( const float backlen ):
-    _backlen(backlen),
-    _xrange(-_backlen, 0.0f),
-    _yrange(nanf(""),nanf("")), // set to nan by default
-    color(dPlotColor)
+void MinMaxWindow::Deque::Grow()
 {
+    const size_t capacity = 2*_data.size();
+    std::vector<entry_t> data(capacity);
+    const size_t mask = capacity-1;
+    for( size_t n=_tail; n != _head; ++n )
+        data[n & mask] = _data[n & _mask];
+    _data.swap(data);
+    _mask = mask;
 }
 
-BlockList::~BlockList()
+void MinMaxWindow::Deque::PushBack( const entry_t& e )
 {
-    blist::iterator i;
-    for( i= _blocks.begin(); i != _blocks.end(); ++i )
-        delete *i;
+    if( _head - _tail == _data.size() )
+        Grow();
+    _data[_head & _mask] = e;
+    ++_head;
 }
 
-void BlockList::Add(const vec2_t &vertex)
+MinMaxWindow::MinMaxWindow( const size_t capacity ):
+    _min(capacity),
+    _max(capacity)
 {
-    if( _blocks.empty() )
-        NewBlock();
+}
 
-    Block* h = _blocks.front();
+void MinMaxWindow::Add( const size_t n, const float y )
+{
+    if( isnan(y) )
+        return;
+
+    entry_t e;
+    e.n = n;
+    e.y = y;
+
+    // entries which can never become the minimum (maximum)
+    // anymore are removed from the back
+    while( !_min.Empty() && _min.Back().y >= y )
+        _min.PopBack();
+    _min.PushBack(e);
+
+    while( !_max.Empty() && _max.Back().y <= y )
+        _max.PopBack();
+    _max.PushBack(e);
+}
 
-    if( h->isFull() ) {
-        NewBlock();
-        h = _blocks.front();
+void MinMaxWindow::Expire( const size_t tail )
+{
+    // compare the indices wrap-safe
+    while( !_min.Empty() && (ptrdiff_t)(_min.Front().n - tail) < 0 )
+        _min.PopFront();
+    while( !_max.Empty() && (ptrdiff_t)(_max.Front().n - tail) < 0 )
+        _max.PopFront();
+}
+
+Interval MinMaxWindow::Range() const
+{
+    if( _min.Empty() )
+        return Interval(nanf(""),nanf(""));
+    return Interval(_min.Front().y, _max.Front().y);
+}
+
+LODPyramid::LODPyramid()
+{
+    // level n has about 4^(n+1) times less vertices than the raw trace,
+    // give them twice the room since partial chunks are flushed at gaps
+    for( size_t n=0; n<BLOCKLIST_LOD_LEVELS; ++n ) {
+        size_t capacity = BLOCKLIST_MIN_VERTICES >> (2*n+1);
+        size_t max = BLOCKLIST_MAX_VERTICES >> (2*n+1);
+        _levels.push_back(new Level(capacity < 16 ? 16 : capacity,
+                                    max < 64 ? 64 : max));
     }
+    _tail.reserve(BLOCKLIST_LOD_LEVELS*BLOCKLIST_LOD_CHUNK+1);
+}
 
-    h->Add( vertex );
+LODPyramid::~LODPyramid()
+{
+    for( size_t n=0; n<_levels.size(); ++n )
+        delete _levels[n];
+}
 
-    Block* last = _blocks.back();
+void LODPyramid::Feed( const size_t level, const vec2_t& vertex )
+{
+    Level* l = _levels[level];
+    l->pending.push_back(vertex);
+    if( l->pending.size() >= BLOCKLIST_LOD_CHUNK )
+        Reduce(level);
+}
 
-    //see if we can disgard the last block
-    if(last != h && last->XRange().Disjoint(_xrange) ) {
-        PopBack();
+void LODPyramid::Reduce( const size_t level )
+{
+    Level* l = _levels[level];
+    if( l->pending.empty() )
+        return;
+
+    size_t imin = 0;
+    size_t imax = 0;
+    for( size_t i=1; i<l->pending.size(); ++i ) {
+        if( l->pending[i].y < l->pending[imin].y )
+            imin = i;
+        if( l->pending[i].y > l->pending[imax].y )
+            imax = i;
     }
 
-    // check if _yrange is valid, if not, 
-    // initialize with the help of this first y value
-    if(isnan(_yrange.Length())) {
-        _yrange = Interval(vertex.y, vertex.y);
+    // emit them in time order,
+    // and only once if it's the same vertex
+    const size_t first = imin < imax ? imin : imax;
+    const size_t second = imin < imax ? imax : imin;
+
+    vec2_t v = l->pending[first];
+    l->ring.Add(v);
+    if( level+1 < _levels.size() )
+        Feed(level+1, v);
+
+    if( second != first ) {
+        v = l->pending[second];
+        l->ring.Add(v);
+        if( level+1 < _levels.size() )
+            Feed(level+1, v);
     }
-    else {
-        _yrange.Extend( vertex.y );
+
+    l->pending.clear();
+}
+
+void LODPyramid::Add( const vec2_t& vertex )
+{
+    Feed(0, vertex);
+}
+
+void LODPyramid::Break()
+{
+    // flush the partial chunks, from the finest level on,
+    // since each level feeds the next coarser one
+    for( size_t n=0; n<_levels.size(); ++n ) {
+        Reduce(n);
+        _levels[n]->ring.Break();
     }
 }
 
-void BlockList::Draw() const
+void LODPyramid::Expire( const float xmin )
 {
+    for( size_t n=0; n<_levels.size(); ++n ) {
+        VertexRing& r = _levels[n]->ring;
+        while( r.Size() > 1 && r.at(r.Tail()+1).x < xmin )
+            r.PopOldest();
+    }
+}
 
+void LODPyramid::Shift( const float dx )
+{
+    for( size_t n=0; n<_levels.size(); ++n ) {
+        _levels[n]->ring.Shift(dx);
+        std::vector<vec2_t>& p = _levels[n]->pending;
+        for( size_t i=0; i<p.size(); ++i )
+            p[i].x += dx;
+    }
+}
 
+void LODPyramid::Draw( const size_t level ) const
+{
+    const VertexRing& r = _levels[level]->ring;
+    r.Draw();
+
+    // vertices not yet reduced are pending: those of this level follow
+    // the drawn ones, those of each finer level follow the coarser ones.
+    // Draw them in that (time) order from the last drawn vertex
+    _tail.clear();
+    if( !r.Empty() && !r.Broken() )
+        _tail.push_back(r.Newest());
+    for( size_t n=level+1; n-- > 0; ) {
+        const std::vector<vec2_t>& p = _levels[n]->pending;
+        _tail.insert(_tail.end(), p.begin(), p.end());
+    }
 
-        color.Activate();
+    if( _tail.size() < 2 )
+        return;
+    glVertexPointer(2, GL_FLOAT, 0, _tail.data());
+    glDrawArrays(GL_LINE_STRIP, 0, _tail.size());
+}
+
+void BlockList::NewBlock( const bool copy_last )
+{
+    // the ring is continuous, so only the
+    // unconnected case needs to be handled
+    if( !copy_last ) {
+        _ring.Break();
+        _lod.Break();
+    }
+}
 
-        blist::const_iterator i;
-        for( i= _blocks.begin(); i != _blocks.end(); ++i )
-            (*i)->Draw();
+BlockList::BlockList( const float backlen ):
+    _ring(),
+    _window(),
+    _lod(),
+    _backlen(backlen),
+    _origin(0.0),
+    _xrange(-_backlen, 0.0f),
+    _yrange(nanf(""),nanf("")), // set to nan by default
+    color(dPlotColor)
+{
+}
 
+BlockList::~BlockList()
+{
+}
 
+void BlockList::Rebase( const double x )
+{
+    // only move forward, older samples are clamped in Add()
+    if( x - _origin < BLOCKLIST_REBASE_TIME )
+        return;
+
+    // use whole seconds, they are exactly representable
+    const double origin = floor(x);
+    const float dx = _origin - origin;
+    _ring.Shift( dx );
+    _lod.Shift( dx );
+    _xrange.Min() += dx;
+    _xrange.Max() += dx;
+    _origin = origin;
+}
 
+vec2_t BlockList::ToVertex( const dvec2_t& sample ) const
+{
+    vec2_t v;
+    v.x = sample.x - _origin;
+    v.y = sample.y;
+    return v;
 }
 
-void BlockList::SetNow(const float now)
+void BlockList::Add(const dvec2_t &sample)
 {
-    _xrange.Max() = now;
-    _xrange.Min() = now - _backlen;
+    Rebase( sample.x );
+    vec2_t vertex = ToVertex( sample );
+
+    // samples older than the retained back-length are clamped to its
+    // start, so they still anchor the line. Drop them if newer vertices
+    // are already in range, the ring must stay ordered.
+    if( vertex.x < _xrange.Min() ) {
+        if( !_ring.Empty() && _ring.Newest().x >= _xrange.Min() )
+            return;
+        vertex.x = _xrange.Min();
+    }
+
+    _ring.Add( vertex );
+    _window.Add( _ring.Head()-1, vertex.y );
+    _lod.Add( vertex );
+
+    // disgard the oldest vertices as long as the
+    // line to their successor is completely out of range
+    while( _ring.Size() > 1 && _ring.at(_ring.Tail()+1).x < _xrange.Min() )
+        _ring.PopOldest();
+    _lod.Expire( _xrange.Min() );
+
+    // the ring might also have dropped vertices when full
+    _window.Expire( _ring.Tail() );
+    _yrange = _window.Range();
 }
 
+void BlockList::Draw( const float xpixels ) const
+{
+    color.Activate();
+
+    const size_t max = 2*xpixels;
+    if( max == 0 || _ring.Size() <= max ) {
+        _ring.Draw();
+        return;
+    }
 
+    // find the finest level which is coarse enough,
+    // or use the coarsest one
+    size_t level = 0;
+    while( level+1 < _lod.Levels() && _lod.Size(level) > max )
+        ++level;
+    _lod.Draw(level);
+}
 
+void BlockList::SetNow(const double now)
+{
+    Rebase( now );
+    _xrange.Max() = now - _origin;
+    _xrange.Min() = now - _origin - _backlen;
+}
@@ -221,12 +221,13 @@ void ConfigManager::do_work() {
     }
 }
 
-void ConfigManager::ExecutePendingCallback()
+bool ConfigManager::ExecutePendingCallback()
 {
     if(_callback_cmd.empty())
-        return;
+        return false;
     _callback_return = _callbacks[_callback_cmd](_callback_arg);
     pthread_cond_signal(&_callback_done);
+    return true;
 }
 
 bool ConfigManager::SendToClient(int client, string msg)
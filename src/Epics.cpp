@@ -4,13 +4,59 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <sched.h>
 #include "config.h"
 #include "Epics.h"
 #include "Structs.h"
+#include "ConfigManager.h"
+#include "SimulatedSource.h"
+#include "ReplaySource.h"
 
 using namespace std;
 
-Epics::Epics () {
+// the properties of a PV we subscribe to besides the value,
+// you may use any DBR_* type except DBR_TIME_DOUBLE, see Epics::eventCallback
+// by default, we don't use the fairly new DBR_CTRL* types to monitor the properties,
+// since many records don't propagate changes correctly... (see Epics::SetCtrlMode)
+static const struct {
+    const char* attr;
+    chtype type;
+} properties[] = {
+    // alarms
+    {"HIHI", DBR_DOUBLE},
+    {"HIGH", DBR_DOUBLE},
+    {"LOW",  DBR_DOUBLE},
+    {"LOLO", DBR_DOUBLE},
+    {"SEVR", DBR_ENUM},
+    // operating ranges
+    {"HOPR", DBR_DOUBLE},
+    {"LOPR", DBR_DOUBLE},
+    // unit
+    {"EGU",  DBR_STRING},
+    {"PREC", DBR_SHORT}
+};
+static const size_t n_properties = sizeof(properties)/sizeof(properties[0]);
+
+size_t Epics::propertySize() {
+    // the pool blocks must hold the largest of the properties
+    size_t size = 0;
+    for(size_t i=0;i<n_properties;i++) {
+        size_t s = dbr_size_n(properties[i].type, 1);
+        if(s>size)
+            size = s;
+    }
+    // the units of DBR_CTRL_DOUBLE are also passed as a property
+    if(sizeof(((dbr_ctrl_double*)0)->units) > size)
+        size = sizeof(((dbr_ctrl_double*)0)->units);
+    return size;
+}
+
+Epics::Epics () :
+    _pool(propertySize(), EPICS_POOL_BLOCKS),
+    _ctrl_mode(false),
+    _replay(NULL)
+{
     // modify the PATH variable such that caRepeater can be
     // found by EPICS. This avoids also a "defunct" thread
     stringstream mypath;
@@ -24,16 +70,175 @@ Epics::Epics () {
     ca_poll();
     t0 = epicsTime::getCurrent();      
     _watch.Start();
+    
+    ConfigManager::I().addCmd("EpicsMetadata", BIND_MEM_CB(&Epics::callbackSetMetadata, this));
+    ConfigManager::I().addCmd("EpicsRecord", BIND_MEM_CB(&Epics::callbackRecord, this));
+    ConfigManager::I().addCmd("EpicsReplay", BIND_MEM_CB(&Epics::callbackReplay, this));
+    AddSource(SIMULATEDSOURCE_PREFIX, new SimulatedSource());
     //cout << "EPICS ctor" << endl;
 }
 
+bool Epics::AddSource(const string& prefix, DataSource* source)
+{
+    // the PVs of the present one would lose their source
+    if(_sources.count(prefix) != 0) {
+        delete source;
+        return false;
+    }
+    _sources[prefix] = source;
+    return true;
+}
+
+DataSource* Epics::findSource(const string& pvname) const
+{
+    // the map is sorted, so a longer prefix comes later
+    DataSource* source = NULL;
+    for(map<string, DataSource*>::const_iterator it = _sources.begin(); it != _sources.end(); ++it) {
+        if(pvname.compare(0, it->first.size(), it->first) == 0)
+            source = it->second;
+    }
+    return source;
+}
+
+bool Epics::Record(const string& filename)
+{
+    if(filename.empty()) {
+        _recorder.Close();
+        return true;
+    }
+    return _recorder.Open(filename);
+}
+
+string Epics::callbackRecord(const string& arg)
+{
+    if(arg == "Stop") {
+        Record("");
+        return ""; // success
+    }
+    if(arg.empty())
+        return "Argument must be a filename or Stop";
+    if(!Record(arg))
+        return "Cannot write "+arg;
+    return ""; // success
+}
+
+string Epics::callbackReplay(const string& arg)
+{
+    if(arg == "Stop") {
+        if(_replay == NULL)
+            return "There is no replay";
+        stopReplay();
+        return ""; // success
+    }
+    
+    stringstream ss(arg);
+    string filename, speed;
+    if(!(ss >> filename))
+        return "Argument must be a filename, optionally followed by Fast, or Stop";
+    ss >> speed;
+    if(!speed.empty() && speed != "Fast")
+        return "Speed must be Fast, or omitted for 1x";
+    if(_replay != NULL)
+        return "There is a replay already";
+    
+    ReplaySource* source = new ReplaySource(speed == "Fast");
+    if(!source->Open(filename)) {
+        delete source;
+        return "Cannot read "+filename;
+    }
+    _replay = source;
+    
+    // the scalar PVs from the IOCs, PVs added later are not replayed
+    size_t n = 0;
+    for(map<string, PV*>::iterator it = pvs.begin(); it != pvs.end(); ++it) {
+        PV* pv = it->second;
+        if(!pv->waveform && pv->source == NULL) {
+            changeSource(pv, _replay);
+            n++;
+        }
+    }
+    cout << "Replaying " << filename << " for " << n << " PVs" << endl;
+    return ""; // success
+}
+
+void Epics::stopReplay()
+{
+    // back to the IOCs
+    for(map<string, PV*>::iterator it = pvs.begin(); it != pvs.end(); ++it) {
+        if(it->second->source == _replay)
+            changeSource(it->second, NULL);
+    }
+    delete _replay;
+    _replay = NULL;
+}
+
+void Epics::changeSource(PV* pv, DataSource* source)
+{
+    // the previous producer is gone before the next one starts,
+    // the consumers see it as a reconnect
+    unsubscribe(pv);
+    Epics::I().InjectConnection(pv, false);
+    
+    pv->source = source;
+    pv->ctrl = false;
+    pv->severity = -1;
+    __atomic_store_n(&pv->passed, false, __ATOMIC_RELAXED);
+    if(source == NULL)
+        subscribe(pv->name, pv);
+    else if(!source->Subscribe(pv->name, pv))
+        cerr << "PV " << pv->name << " not known by its data source" << endl;
+}
+
+bool Epics::isConnected(const PV* pv)
+{
+    if(pv->source != NULL)
+        return pv->connected;
+    return ca_state(pv->channels[0]._chid) == cs_conn;
+}
+
+string Epics::callbackSetMetadata(const string& arg)
+{
+    if(arg == "Ctrl") {
+        SetCtrlMode(true);
+    }
+    else if(arg == "Fields") {
+        SetCtrlMode(false);
+    }
+    else {
+        return "Argument must be Ctrl or Fields";
+    }
+    return ""; // success, applies to PVs added from now on
+}
+
 Epics::~Epics () {
+    ConfigManager::I().removeCmd("EpicsMetadata");
+    ConfigManager::I().removeCmd("EpicsRecord");
+    ConfigManager::I().removeCmd("EpicsReplay");
+    // usually, all consumers are already gone
     for (map<string, PV*>::iterator it = pvs.begin(); it != pvs.end(); ++it ) {
-        removePV(it->first);
+        PV* pv = it->second;
+        pthread_mutex_lock(&pv->mutex);
+        vector<Consumer*> consumers;
+        consumers.swap(pv->consumers);
+        publishReaders(pv);
+        pthread_mutex_unlock(&pv->mutex);
+        for(size_t i=0;i<consumers.size();i++)
+            delete consumers[i];
+        releasePV(pv);
     }
     pvs.clear();
+    // all PVs are unsubscribed now
+    delete _replay;
+    _replay = NULL;
+    for (map<string, DataSource*>::iterator it = _sources.begin(); it != _sources.end(); ++it )
+        delete it->second;
+    _sources.clear();
     ca_context_destroy();
     
+    cout << "EPICS property pool: " << _pool.Hits() << " hits, " 
+         << _pool.Misses() << " misses, " 
+         << _pool.HighWater() << "/" << _pool.Blocks() << " blocks max. used" << endl;
+    
     //cout << "EPICS dtor" << endl;
 }
 
@@ -45,50 +250,223 @@ void Epics::exceptionCallback( exception_handler_args args ) {
 }
 
 void Epics::deleteDataItem(DataItem* i) {
-    // well, the void* data should be freed
+    // the copy of the property
     // (see the callbacks below where these items are generated)
-    switch (i->type) {
-    case Epics::NewValue:
-        free(i->data);
-        break;
-    case Epics::NewProperties:
-        free(i->data);
-        break;
-    default:
-        // all other types currently 
-        // don't fill something
-        // in the i->data
-        break;
-    }            
-    // delete the current item, 
-    // this hopefully calls destructors of nested items
-    delete i;    
-}
-
-void Epics::fillList(DataItem *head, vector<DataItem*>& list)
-{
-    // scan the linked list
-    list.reserve(100);
-    DataItem* d = head; // start from the head
-    while(d->prev != NULL) {
-        list.push_back(d);
-        d = d->prev;
+    // has to be freed, all other types are stored within the item
+    if(i->type == Epics::NewProperties) {
+        Epics::I()._pool.Free(i->data);
+        i->data = NULL;
     }
 }
 
-void Epics::connectionCallback( connection_handler_args args ) { 
-    DataItem* pNew = new DataItem;
+void Epics::publishReaders(PV* pv)
+{
+    ReaderList* readers = new ReaderList(pv->consumers.size());
+    for(size_t i=0;i<readers->size();i++) {
+        Reader& r = (*readers)[i];
+        r.c = pv->consumers[i];
+        r.filter = r.c->filter;
+        r.auto_call = r.c->auto_call;
+    }
+    ReaderList* previous = __atomic_exchange_n(&pv->readers, readers, __ATOMIC_SEQ_CST);
     
-    if ( args.op == CA_OP_CONN_UP ) {
-        // channel has connected
-        pNew->type = Connected;
-    } 
-    else { // args.op == CA_OP_CONN_DOWN
-        pNew->type = Disconnected;
+    // if the producer doesn't read now, it gets the new ones next time
+    while(__atomic_load_n(&pv->reading, __ATOMIC_SEQ_CST))
+        sched_yield();
+    delete previous;
+}
+
+const Epics::ReaderList& Epics::beginRead(PV* pv)
+{
+    __atomic_store_n(&pv->reading, 1, __ATOMIC_SEQ_CST);
+    return *__atomic_load_n(&pv->readers, __ATOMIC_SEQ_CST);
+}
+
+void Epics::endRead(PV* pv)
+{
+    __atomic_store_n(&pv->reading, 0, __ATOMIC_RELEASE);
+}
+
+size_t Epics::oldestItem(const PV* pv, const ReaderList& readers)
+{
+    // compare the cursors wrap-safe,
+    // the consumers are done with the items before their tail
+    size_t oldest = pv->head;
+    for(size_t i=0;i<readers.size();i++) {
+        const size_t tail = __atomic_load_n(&readers[i].c->tail, __ATOMIC_ACQUIRE);
+        if((ptrdiff_t)(tail - oldest) < 0)
+            oldest = tail;
     }
-    string pvname = ( args.chid ? ca_name( args.chid ) : "unknown" );
-    //cout << "Connection " << pvname << endl;
-    appendToList((PV*)ca_puser(args.chid), pNew);
+    return oldest;
+}
+
+bool Epics::skip(const Filter& f, double last_t, double last_y,
+                 double t, double y, bool waveform)
+{
+    double band = f.deadband_rel * fabs(last_y);
+    if(f.deadband > band)
+        band = f.deadband;
+    // the deadband doesn't apply to arrays
+    const bool in_band = band > 0 && fabs(y - last_y) <= band && !waveform;
+    return t - last_t < f.min_interval || in_band;
+}
+
+bool Epics::filter(PV* pv, double t, double y, short severity)
+{
+    // always tell about the first update or a new severity,
+    // otherwise keep it if any consumer wants it
+    bool drop = __atomic_load_n(&pv->passed, __ATOMIC_RELAXED) && severity == pv->passed_severity;
+    const ReaderList& readers = beginRead(pv);
+    for(size_t i=0;i<readers.size() && drop;i++)
+        drop = skip(readers[i].filter, pv->passed_time, pv->passed_value, t, y, pv->waveform);
+    endRead(pv);
+    
+    if(!drop) {
+        __atomic_store_n(&pv->passed, true, __ATOMIC_RELAXED);
+        pv->passed_time = t;
+        pv->passed_value = y;
+        pv->passed_severity = severity;
+        return false;
+    }
+    
+    // the consumers pick up the latest one, see processConsumer(),
+    // the arrays are gone though
+    if(!pv->waveform) {
+        const size_t seq = pv->held_seq;
+        __atomic_store_n(&pv->held_seq, seq+1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        pv->held.type = NewValue;
+        pv->held.value.x = t;
+        pv->held.value.y = y;
+        pv->held.severity = severity;
+        pv->held_at = pv->head;
+        __atomic_store_n(&pv->held_seq, seq+2, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+bool Epics::filterConsumer(Consumer* c, const DataItem* i)
+{
+    if(c->passed && i->severity == c->passed_severity &&
+       skip(c->filter, c->passed_time, c->passed_value, i->value.x, i->value.y, false)) {
+        // a later one replaces it
+        c->held = *i;
+        c->holding = true;
+        return true;
+    }
+    c->passed = true;
+    c->passed_time = i->value.x;
+    c->passed_value = i->value.y;
+    c->passed_severity = i->severity;
+    c->holding = false;
+    return false;
+}
+
+Epics::DataItem* Epics::beginAppend(PV* pv, DataType type)
+{
+    // only the producer modifies head,
+    // the consumers might advance their tail concurrently (which only frees space)
+    const size_t oldest = oldestItem(pv, beginRead(pv));
+    endRead(pv);
+    
+    // all consumers are done with the items before oldest
+    for(; pv->reclaimed != oldest; pv->reclaimed++)
+        deleteDataItem(&pv->queue[pv->reclaimed & (EPICS_QUEUE_SIZE-1)]);
+    
+    const size_t used = pv->head - oldest;
+    const size_t limit = type == NewValue || type == NewWaveform ? 
+                EPICS_QUEUE_SIZE - EPICS_QUEUE_RESERVED : EPICS_QUEUE_SIZE;
+    if(used >= limit) {
+        __atomic_store_n(&pv->dropped, pv->dropped+1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    DataItem* i = &pv->queue[pv->head & (EPICS_QUEUE_SIZE-1)];
+    i->type = type;
+    return i;
+}
+
+void Epics::record(PV* pv, DataType type, double x, double y, short severity,
+                   const char* attr, const void* data, size_t nBytes)
+{
+    // the arrays are not recorded, nor is anything else of the
+    // waveform, since it would be replayed as the scalar PV
+    PVLogWriter& recorder = Epics::I()._recorder;
+    if(!recorder.IsOpen() || pv->waveform)
+        return;
+    recorder.Write(type, pv->name, attr, severity, Epics::I().GetCurrentTime(), 
+                   x, y, data, nBytes);
+}
+
+void Epics::endAppend(PV* pv)
+{
+    // ensure the item is completely written 
+    // before it's made visible to the consumers
+    __atomic_store_n(&pv->head, pv->head+1, __ATOMIC_RELEASE);
+    
+    // no lock is held, a consumer is only deleted
+    // once the producer is done with the readers
+    const ReaderList& readers = beginRead(pv);
+    for(size_t i=0;i<readers.size();i++) {
+        if(readers[i].auto_call)
+            processConsumer(readers[i].c);
+    }
+    endRead(pv);
+}
+
+void Epics::appendProperty(PV* pv, const char* attr, const void* data, size_t nBytes)
+{
+    record(pv, NewProperties, 0, 0, 0, attr, data, nBytes);
+    
+    DataItem* pNew = beginAppend(pv, NewProperties);
+    if(pNew == NULL)
+        return;
+    
+    // the "attr" name of the property
+    pNew->attr = attr;
+    
+    // copy the content, since it's only valid within the callback
+    pNew->data = Epics::I()._pool.Alloc(nBytes);
+    memcpy(pNew->data, data, nBytes);       
+    
+    endAppend(pv);
+}
+
+void Epics::appendCtrl(PV* pv, const dbr_ctrl_double* dbr)
+{
+    // split it into the same properties as if
+    // they were subscribed field by field
+    appendProperty(pv, "HIHI", &dbr->upper_alarm_limit, sizeof(dbr_double_t));
+    appendProperty(pv, "HIGH", &dbr->upper_warning_limit, sizeof(dbr_double_t));
+    appendProperty(pv, "LOW",  &dbr->lower_warning_limit, sizeof(dbr_double_t));
+    appendProperty(pv, "LOLO", &dbr->lower_alarm_limit, sizeof(dbr_double_t));
+    appendProperty(pv, "HOPR", &dbr->upper_disp_limit, sizeof(dbr_double_t));
+    appendProperty(pv, "LOPR", &dbr->lower_disp_limit, sizeof(dbr_double_t));
+    appendProperty(pv, "PREC", &dbr->precision, sizeof(dbr_short_t));
+    
+    // the severity is included as well,
+    // which helps consumers which join later
+    dbr_enum_t sevr = dbr->severity;
+    appendProperty(pv, "SEVR", &sevr, sizeof(sevr));
+    pv->severity = dbr->severity;
+    
+    // ensure the unit is terminated
+    char units[sizeof(dbr->units)];
+    strncpy(units, dbr->units, sizeof(units));
+    units[sizeof(units)-1] = '\0';
+    appendProperty(pv, "EGU", units, sizeof(units));
+}
+
+void Epics::connectionCallback( connection_handler_args args ) { 
+    PV_channel_t* channel = (PV_channel_t*)ca_puser(args.chid);
+    
+    // channel has connected or args.op == CA_OP_CONN_DOWN
+    const DataType type = args.op == CA_OP_CONN_UP ? Connected : Disconnected;
+    record(channel->_pv, type);
+    DataItem* pNew = beginAppend(channel->_pv, type);
+    if(pNew == NULL)
+        return;
+    //cout << "Connection " << ca_name(args.chid) << endl;
+    endAppend(channel->_pv);
 }
 
 void Epics::eventCallback( event_handler_args args ) {
@@ -98,14 +476,12 @@ void Epics::eventCallback( event_handler_args args ) {
     } 
     
     // since the content of dbr is only valid within
-    // this callback, we create some new memory space here
-    // and hardcopy it
+    // this callback, we copy it into the queue
     
-    PV* pv = (PV*)args.usr;
-    DataItem* pNew = new DataItem;        
+    PV_channel_t* channel = (PV_channel_t*)args.usr;
+    PV* pv = channel->_pv;
     
     if(args.type == DBR_TIME_DOUBLE) {
-        vec2_t* data = new vec2_t;
         dbr_time_double* dbr = (dbr_time_double*)args.dbr; // Convert void* to correct data type
         
         // we use the timestamp to see if this
@@ -114,152 +490,320 @@ void Epics::eventCallback( event_handler_args args ) {
         // that the change of the value happened "right now"
         epicsTime time(dbr->stamp);
         double t = time - Epics::I().t0;
-        data->x= t<0 ? t : Epics::I().GetCurrentTime();
-        // y-value is easy
-        data->y = dbr->value;
+        if(t >= 0)
+            t = Epics::I().GetCurrentTime();
         
-        // pack it together
-        pNew->type = NewValue;
-        pNew->data = data;   
-    }
-    else {
+        // in ctrl mode, there's no SEVR channel,
+        // so we tell about changes of the severity
+        // (the filter always passes them anyway)
+        if(pv->ctrl && dbr->severity != pv->severity) {
+            dbr_enum_t sevr = dbr->severity;
+            appendProperty(pv, "SEVR", &sevr, sizeof(sevr));
+            pv->severity = dbr->severity;
+        }
+        
+        // what the IOC sent, not what's displayed
+        record(pv, NewValue, t, dbr->value, dbr->severity);
         
-        pNew->type = NewProperties;
+        // drop it as early as possible
+        if(filter(pv, t, dbr->value, dbr->severity))
+            return;
         
-        // determine the "attr" name of the property.
-        pNew->attr = "_UNKNOWN";
-        for(size_t i=0; i<pv->channels.size(); i++) {
-            if(args.chid == pv->channels[i]._chid) {
-                pNew->attr = pv->channels[i]._attr;
-                break;
+        if(pv->waveform) {
+            // the array goes directly into the slabs of the consumers,
+            // the item just tells about it
+            const ReaderList& readers = beginRead(pv);
+            for(size_t i=0;i<readers.size();i++) {
+                if(readers[i].c->waveform != NULL)
+                    readers[i].c->waveform->Write(&dbr->value, args.count, t);
             }
+            endRead(pv);
         }
-        // copy the content, since args is only valid within this callback
+        
+        DataItem* pNew = beginAppend(pv, pv->waveform ? NewWaveform : NewValue);
+        if(pNew == NULL)
+            return;
+        
+        pNew->value.x = t;
+        // y-value is easy
+        pNew->value.y = pv->waveform ? args.count : dbr->value;
+        pNew->severity = dbr->severity;
+        
+        endAppend(pv);
+    }
+    else if(args.type == DBR_CTRL_DOUBLE) {
+        appendCtrl(pv, (const dbr_ctrl_double*)args.dbr);
+    }
+    else {
         size_t nBytes = dbr_size_n(args.type, args.count);
-        //cout << "ATTR: " << pNew->attr << " nBytes: " << nBytes << endl;
-        pNew->data = malloc(nBytes);
-        memcpy(pNew->data, args.dbr, nBytes);       
+        //cout << "ATTR: " << channel->_attr << " nBytes: " << nBytes << endl;
+        appendProperty(pv, channel->_attr.c_str(), args.dbr, nBytes);
     }
-    
-    appendToList(pv, pNew);    
 }
 
-void Epics::appendToList(Epics::PV* pv, Epics::DataItem *pNew)
+string Epics::key(const string& pvname, bool waveform)
 {
-    while (1) { // concurrency loop
-        DataItem* pOld = pv->head;  // copy the state of the world. We operate on the copy
-        pNew->prev = pOld; // chain the new node to the current head of recycled items
-        if (__sync_bool_compare_and_swap(&pv->head, pOld, pNew))  // switch head of recycled items to new node
-            break; // success
-    }
-    //cout << "Something was appended. Contents:" << endl;
-    if(pv->auto_call)
-        processNewDataForPV(pv);
-        
+    // a PV can be shown as scalar and waveform at the same time
+    return waveform ? pvname + "[]" : pvname;
 }
 
-void Epics::addPV(const string &pvname, EpicsCallback cb, bool autoCall)
+Epics::Subscription Epics::addPV(const string &pvname, EpicsCallback cb, bool autoCall,
+                                 WaveformBuffer* waveform)
 {    
-    PV* pv = initPV();
-    pv->cb = cb;
-    pv->auto_call = autoCall;
-    
-    // subscribe to value and control
-    subscribe(pvname, pv);
-    
-    // save the pv
-    pvs[pvname] = pv;
-    cout << "PV " << pvname << " registered" << endl;
-    
+    Consumer* c = new Consumer;
+    c->cb = cb;
+    c->auto_call = autoCall;
+    c->joined = false;
+    c->waveform = waveform;
+    c->filter.min_interval = 0;
+    c->filter.deadband = 0;
+    c->filter.deadband_rel = 0;
+    c->passed = false;
+    c->passed_time = 0;
+    c->passed_value = 0;
+    c->passed_severity = -1;
+    c->holding = false;
+    c->dropped_time = 0;
     
+    map<string, PV*>::iterator it = pvs.find(key(pvname, waveform != NULL));
+    PV* pv;
+    if(it == pvs.end()) {
+        pv = initPV(pvname);
+        pv->waveform = waveform != NULL;
+        // the sources only provide scalars
+        pv->source = pv->waveform ? NULL : findSource(pvname);
+        // the consumer must be known before any callback arrives
+        c->pv = pv;
+        c->tail = 0;
+        c->dropped_reported = 0;
+        c->held_seq = 0;
+        pthread_mutex_lock(&pv->mutex);
+        pv->consumers.push_back(c);
+        publishReaders(pv);
+        pthread_mutex_unlock(&pv->mutex);
+        
+        // subscribe to value and control
+        if(pv->source == NULL)
+            subscribe(pvname, pv);
+        else if(!pv->source->Subscribe(pvname, pv))
+            cerr << "PV " << pvname << " not known by its data source" << endl;
+        
+        // save the pv
+        pvs[key(pvname, pv->waveform)] = pv;
+        cout << "PV " << pvname << " registered" << endl;
+    }
+    else {
+        pv = it->second;
+        // start with the next item, the
+        // current state is requested below
+        pthread_mutex_lock(&pv->mutex);
+        c->pv = pv;
+        c->tail = __atomic_load_n(&pv->head, __ATOMIC_ACQUIRE);
+        c->dropped_reported = __atomic_load_n(&pv->dropped, __ATOMIC_RELAXED);
+        c->held_seq = __atomic_load_n(&pv->held_seq, __ATOMIC_ACQUIRE);
+        c->joined = true;
+        // the producer still might delete items after this tail
+        // with the previous readers, so it's not called yet
+        c->auto_call = false;
+        pv->consumers.push_back(c);
+        publishReaders(pv);
+        // now the items from the current head on are kept
+        __atomic_store_n(&c->tail, __atomic_load_n(&pv->head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+        c->auto_call = autoCall;
+        publishReaders(pv);
+        const size_t n = pv->consumers.size();
+        pthread_mutex_unlock(&pv->mutex);
+        
+        refresh(pv);
+        cout << "PV " << pvname << " shared by " << n << " consumers" << endl;
+    }
+    return c;
 }
 
-Epics::PV* Epics::initPV() {
+Epics::PV* Epics::initPV(const string& pvname) {
     // create the one and only data structure,
-    // initialize the linked list (atomically modified by EPICS threads)
+    // including the queue written by the EPICS threads
     PV* pv = new PV;
-    DataItem* head = new DataItem; // create the first dummy item
-    head->prev = NULL; // ensure it points to nothing before  
-    pv->head = head; // save the pointer in the pv as a starting point
-    pv->head_last = NULL;
+    pv->name = pvname;
+    pthread_mutex_init(&pv->mutex, NULL);
+    pv->readers = new ReaderList();
+    pv->reading = 0;
+    pv->queue = new DataItem[EPICS_QUEUE_SIZE];
+    pv->head = 0;
+    pv->reclaimed = 0;
+    pv->dropped = 0;
+    pv->ctrl = false;
+    pv->waveform = false;
+    pv->source = NULL;
+    pv->connected = false;
+    pv->severity = -1;
+    pv->passed = false;
+    pv->passed_time = 0;
+    pv->passed_value = 0;
+    pv->passed_severity = -1;
+    pv->held_at = 0;
+    pv->held_seq = 0;
     return pv;    
 } 
 
-void Epics::subscribe_channel(const string &pvname, PV* pv, 
-                              const string &attr, chtype type ) {
-    PV_channel_t channel;
+void Epics::subscribe_channel(const string &pvname, PV_channel_t& channel, 
+                              const string &attr, chtype type, unsigned long count ) {
     channel._attr = attr; // remember the attribute, see Epics::eventCallback
+    channel._evid_ctrl = NULL;
     int ca_rtn = ca_create_channel( (pvname+"."+attr).c_str(),      // PV name including attr
                                     connectionCallback,  // name of connection callback function
-                                    pv,               // 
+                                    &channel,            // 
                                     CA_PRIORITY_DEFAULT, // CA Priority
                                     &channel._chid );    // Unique channel id
     SEVCHK(ca_rtn, "ca_create_channel failed");
     ca_rtn = ca_create_subscription( type,          // CA data type
-                                     1,                        // number of elements
+                                     count,                    // number of elements, 0 is the current length
                                      channel._chid,            // unique channel id
-                                     DBE_VALUE,    // event mask (change of value)
+                                     // event mask (change of value, and alarm if we don't have a SEVR channel)
+                                     channel._pv->ctrl ? DBE_VALUE | DBE_ALARM : DBE_VALUE,
                                      eventCallback,            // name of event callback function
-                                     pv,
+                                     &channel,
                                      &channel._evid );         // unique event id needed to clear subscription
     SEVCHK(ca_rtn, "ca_create_subscription failed");
-    
-    pv->channels.push_back(channel);
 }
 
 void Epics::subscribe(const string &pvname, PV* pv) {
     
-    // create/subscribe for value
-    subscribe_channel(pvname, pv, "VAL", DBR_TIME_DOUBLE);
+    // the channels are the user pointers of the callbacks,
+    // so they must not move in memory anymore
+    // in ctrl mode, the value channel also delivers the properties
+    pv->ctrl = Epics::I()._ctrl_mode;
+    pv->channels.resize(pv->ctrl ? 1 : 1+n_properties);
+    for(size_t i=0;i<pv->channels.size();i++)
+        pv->channels[i]._pv = pv;
     
+    // create/subscribe for value, arrays with their native length
+    subscribe_channel(pvname, pv->channels[0], "VAL", DBR_TIME_DOUBLE, pv->waveform ? 0 : 1);
     
-    // create/subscribe for interesting properties: alarms, operating ranges, unit
-    // you may use any DBR_* type except DBR_TIME_DOUBLE, see Epics::eventCallback
-    // we don't use the fairly new DBR_CTRL* types to monitor the properties,
-    // since many records don't propagate changes correctly...
-    subscribe_channel(pvname, pv, "HIHI", DBR_DOUBLE);
-    subscribe_channel(pvname, pv, "HIGH", DBR_DOUBLE);
-    subscribe_channel(pvname, pv, "LOW",  DBR_DOUBLE);
-    subscribe_channel(pvname, pv, "LOLO", DBR_DOUBLE);
-    subscribe_channel(pvname, pv, "SEVR", DBR_ENUM);    
-    subscribe_channel(pvname, pv, "HOPR", DBR_DOUBLE);
-    subscribe_channel(pvname, pv, "LOPR", DBR_DOUBLE);
-    subscribe_channel(pvname, pv, "EGU",  DBR_STRING);
-    subscribe_channel(pvname, pv, "PREC", DBR_SHORT);
+    if(pv->ctrl) {
+        // the first callback of the subscription serves as the get,
+        // the following ones are only delivered if the IOC supports DBE_PROPERTY 
+        PV_channel_t& channel = pv->channels[0];
+        int ca_rtn = ca_create_subscription( DBR_CTRL_DOUBLE,
+                                             1,
+                                             channel._chid,
+                                             DBE_PROPERTY,
+                                             eventCallback,
+                                             &channel,
+                                             &channel._evid_ctrl );
+        SEVCHK(ca_rtn, "ca_create_subscription for DBR_CTRL_DOUBLE failed");
+    }
+    else {
+        // create/subscribe for interesting properties, see above
+        for(size_t i=0;i<n_properties;i++)
+            subscribe_channel(pvname, pv->channels[1+i], 
+                              properties[i].attr, properties[i].type);
+    }
     
     ca_poll();
 }
 
-void Epics::removePV(const string& pvname)
+void Epics::refresh(PV* pv)
 {
-    // hopefully, the pvname exists :)
-    PV* pv = pvs[pvname];
+    // get the current value and properties once more,
+    // the other consumers just receive them twice
+    if(!isConnected(pv))
+        return; // everything arrives anyway after connecting
+    
+    // the value must not be filtered,
+    // the producer reads it concurrently
+    __atomic_store_n(&pv->passed, false, __ATOMIC_RELAXED);
+    
+    if(pv->source != NULL) {
+        pv->source->Refresh(pv);
+        return;
+    }
     
-    // cancel the subscription/channels
     for(size_t i=0;i<pv->channels.size();i++) {
-        int ca_rtn = ca_clear_subscription (pv->channels[i]._evid);
-        SEVCHK(ca_rtn, "ca_clear_subscription failed");
+        PV_channel_t& channel = pv->channels[i];
+        if(ca_state(channel._chid) != cs_conn)
+            continue;
+        const chtype type = i==0 ? DBR_TIME_DOUBLE : properties[i-1].type;
+        const unsigned long count = i==0 && pv->waveform ? 0 : 1;
+        int ca_rtn = ca_array_get_callback(type, count, channel._chid, eventCallback, &channel);
+        SEVCHK(ca_rtn, "ca_array_get_callback failed");
+    }
+    if(pv->ctrl) {
+        PV_channel_t& channel = pv->channels[0];
+        int ca_rtn = ca_array_get_callback(DBR_CTRL_DOUBLE, 1, channel._chid, eventCallback, &channel);
+        SEVCHK(ca_rtn, "ca_array_get_callback for DBR_CTRL_DOUBLE failed");
+    }
+    ca_poll();
+}
+
+void Epics::removePV(Subscription c)
+{
+    PV* pv = c->pv;
     
-        ca_rtn = ca_clear_channel(pv->channels[i]._chid);
-        SEVCHK(ca_rtn, "ca_clear_channel failed");
+    pthread_mutex_lock(&pv->mutex);
+    for(size_t i=0;i<pv->consumers.size();i++) {
+        if(pv->consumers[i] == c) {
+            pv->consumers.erase(pv->consumers.begin()+i);
+            break;
+        }
     }
+    // waits until the producer is done with c
+    publishReaders(pv);
+    const size_t n = pv->consumers.size();
+    pthread_mutex_unlock(&pv->mutex);
+    delete c;
     
-    ca_poll();    
+    if(n > 0) {
+        cout << "PV " << pv->name << " shared by " << n << " consumers" << endl;
+        return;
+    }
+    
+    // remove it from container
+    pvs.erase(key(pv->name, pv->waveform));    
+    cout << "PV " << pv->name << " unregistered" << endl;
+    releasePV(pv);
+}
+
+void Epics::releasePV(PV* pv)
+{
+    unsubscribe(pv);
     
-    // properly delete the linked list
-    typedef vector<DataItem*> list_t;
-    list_t list;
-    fillList(pv->head, list);
-    for(list_t::iterator it = list.begin(); it != list.end(); ++it) {
-        deleteDataItem(*it);
+    // properly delete the unprocessed items
+    for(size_t n=pv->reclaimed; n != pv->head; n++) {
+        deleteDataItem(&pv->queue[n & (EPICS_QUEUE_SIZE-1)]);
     }
+    delete [] pv->queue;
+    delete pv->readers;
+    pthread_mutex_destroy(&pv->mutex);
     
     // the item itself
     delete pv;    
+}
+
+void Epics::unsubscribe(PV* pv)
+{
+    // waits for the updates in progress as well
+    if(pv->source != NULL)
+        pv->source->Unsubscribe(pv);
     
-    // remove it from container
-    pvs.erase(pvname);    
-    cout << "PV " << pvname << " unregistered" << endl;
+    // cancel the subscription/channels,
+    // this waits for the callbacks in progress
+    for(size_t i=0;i<pv->channels.size();i++) {
+        int ca_rtn = ca_clear_subscription (pv->channels[i]._evid);
+        SEVCHK(ca_rtn, "ca_clear_subscription failed");
+        
+        if(pv->channels[i]._evid_ctrl != NULL) {
+            ca_rtn = ca_clear_subscription (pv->channels[i]._evid_ctrl);
+            SEVCHK(ca_rtn, "ca_clear_subscription failed");
+        }
+    
+        ca_rtn = ca_clear_channel(pv->channels[i]._chid);
+        SEVCHK(ca_rtn, "ca_clear_channel failed");
+    }
+    
+    if(!pv->channels.empty())
+        ca_poll();    
+    pv->channels.clear();
 }
 
 double Epics::GetCurrentTime()
@@ -268,66 +812,150 @@ double Epics::GetCurrentTime()
     return _watch.TimeElapsed();
 }
 
-void Epics::processNewDataForPV(const string& pvname) {
-    processNewDataForPV(pvs[pvname]);
+double Epics::GetStartTime() const
+{
+    const epicsTimeStamp ts = t0;
+    return POSIX_TIME_AT_EPICS_EPOCH + (double) ts.secPastEpoch + 1e-9 * ts.nsec;
 }
 
-void Epics::processNewDataForPV(PV* pv)
+Epics::Producer Epics::findProducer(const string& pvname)
 {
-      
-    // get the pointer to the most recent item 
-    // in the list (snapshot of current state)
-    DataItem* head = pv->head;
+    map<string, PV*>::iterator it = pvs.find(key(pvname, false));
+    return it == pvs.end() ? NULL : it->second;
+}
+
+void Epics::InjectConnection(Producer pv, bool connected)
+{
+    // same as connectionCallback
+    record(pv, connected ? Connected : Disconnected);
+    if(beginAppend(pv, connected ? Connected : Disconnected) == NULL)
+        return;
+    pv->connected = connected;
+    endAppend(pv);
+}
+
+void Epics::InjectValue(Producer pv, double t, double value, short severity)
+{
+    // same as eventCallback for DBR_TIME_DOUBLE
+    record(pv, NewValue, t, value, severity);
+    if(filter(pv, t, value, severity))
+        return;
     
-    // is there something new in
-    // the linked list since the last 
-    // call?
-    if(pv->head_last != NULL && pv->head_last == head) 
-        return;   
+    DataItem* pNew = beginAppend(pv, NewValue);
+    if(pNew == NULL)
+        return;
+    pNew->value.x = t;
+    pNew->value.y = value;
+    pNew->severity = severity;
+    endAppend(pv);
+}
+
+void Epics::InjectProperty(Producer pv, const char* attr, const void* data, size_t nBytes)
+{
+    appendProperty(pv, attr, data, nBytes);
+}
+
+size_t Epics::Pending(Producer pv) const
+{
+    const size_t pending = pv->head - oldestItem(pv, beginRead(pv));
+    endRead(pv);
+    return pending;
+}
+
+void Epics::processNewDataForPV(Subscription c) {
+    processConsumer(c);
+}
+
+void Epics::SetFilter(Subscription c, double min_interval, double deadband, double deadband_rel)
+{
+    pthread_mutex_lock(&c->pv->mutex);
+    c->filter.min_interval = min_interval;
+    c->filter.deadband = deadband;
+    c->filter.deadband_rel = deadband_rel;
+    // the producer gets a copy
+    publishReaders(c->pv);
+    pthread_mutex_unlock(&c->pv->mutex);
+}
+
+void Epics::processConsumer(Consumer* c)
+{
+    PV* pv = c->pv;
     
-    // scan the linked list
-    typedef vector<DataItem*> list_t;
-    list_t list;
-    Epics::fillList(head, list);    
+    // a consumer which joined an already connected PV
+    // would never see the Connected item
+    if(c->joined) {
+        c->joined = false;
+        if(isConnected(pv)) {
+            DataItem i;
+            i.type = Connected;
+            (c->cb)(&i);
+        }
+    }
     
-    // the very first call, _head_last is NULL, thus everything is new!
-    bool newData = pv->head_last == NULL;
+    // snapshot of the current state,
+    // the items up to head are completely written.
+    // The value discarded by the producer goes before 
+    // the item at held_at, if this consumer didn't read it already.
+    // It's consistent if its sequence was even and didn't change meanwhile
+    size_t seq, head, held_at;
+    DataItem held;
+    do {
+        seq = __atomic_load_n(&pv->held_seq, __ATOMIC_ACQUIRE);
+        held = pv->held;
+        held_at = pv->held_at;
+        head = __atomic_load_n(&pv->head, __ATOMIC_ACQUIRE);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while((seq & 1) || seq != __atomic_load_n(&pv->held_seq, __ATOMIC_RELAXED));
+    bool adopt = seq != c->held_seq && (ptrdiff_t)(held_at - c->tail) >= 0;
+    c->held_seq = seq;
     
-    // go thru the vector in positive time direction (ie reverse direction)
-    // note that the linked list (scanned above) starts from the head (most recent item!)    
-    for(list_t::reverse_iterator it=list.rbegin(); // reverse begin
-        it!=list.rend(); // reverse end
-        ++it) {
-        
-        DataItem* i = (*it);
-        if(i->prev == pv->head_last) {
-            newData = true;
-        }      
-        
-        if(!newData)
+    // go thru the queue in positive time direction,
+    // at most EPICS_QUEUE_SIZE items. They're deleted 
+    // by the producer once all consumers are done
+    size_t n;
+    for(n = c->tail; ; n++) {
+        if(adopt && n == held_at) {
+            adopt = false;
+            if(!filterConsumer(c, &held))
+                (c->cb)(&held);
+        }
+        if(n == head)
+            break;
+        const DataItem* i = &pv->queue[n & (EPICS_QUEUE_SIZE-1)];
+        if(i->type == NewValue && filterConsumer(c, i))
             continue;
-        
-        // if new, let it be processed
-        (pv->cb)(i);
-        
+        // a value from before doesn't belong to a new connection
+        if(i->type == Disconnected)
+            c->holding = false;
+        (c->cb)(i);
     }
-    // remember the last head for the next call
-    pv->head_last = head;
     
-    // do not delete the last two elements, 
-    // which are still needed to build the list atomically
-    for(list_t::reverse_iterator it=list.rbegin(); // reverse begin
-        it<list.rend()-2; // reverse end, but not the last two!
-        ++it) {
-        // delete the current one properly
-        DataItem* cur = *it;
-        deleteDataItem(cur);   
-        // and tell the next, that it's not pointing backwards to
-        // us anymore
-        DataItem* next = *(it+1);
-        next->prev = NULL;
+    // we're done with the items, 
+    // give them back to the producer
+    __atomic_store_n(&c->tail, n, __ATOMIC_RELEASE);
+    
+    // the interval of the held back value is over,
+    // if nothing newer arrives it would never be shown
+    if(c->holding && Epics::I().GetCurrentTime() - c->passed_time >= c->filter.min_interval) {
+        c->holding = false;
+        // just the deadband is left to check
+        if(!skip(c->filter, c->passed_time, c->passed_value, 
+                 c->passed_time + c->filter.min_interval, c->held.value.y, false)) {
+            c->passed_time = c->held.value.x;
+            c->passed_value = c->held.value.y;
+            (c->cb)(&c->held);
+        }
+    }
+    
+    // tell about overflows, but not too often
+    const size_t dropped = __atomic_load_n(&pv->dropped, __ATOMIC_RELAXED);
+    if(dropped != c->dropped_reported) {
+        const double now = Epics::I().GetCurrentTime();
+        if(now - c->dropped_time > 1.0) {
+            cerr << "PV " << pv->name << ": Queue full, dropped " 
+                 << dropped - c->dropped_reported << " items" << endl;
+            c->dropped_reported = dropped;
+            c->dropped_time = now;
+        }
     }
 }
-
-
-
@@ -0,0 +1,96 @@
+#include "FrameScheduler.h"
+#include <time.h>
+#include <sstream>
+
+using namespace std;
+
+// frames without drawing before throttling to the idle rate,
+// given in seconds at the target rate
+#define IDLE_AFTER 1.0
+
+FrameScheduler::FrameScheduler():
+    _target_fps(50),
+    _idle_fps(10),
+    _start(0),
+    _frame_start(0),
+    _next(0),
+    _undrawn(0),
+    _report_start(0),
+    _frames(0),
+    _drawn(0),
+    _over_budget(0),
+    _sum_frame_time(0),
+    _max_frame_time(0)
+{
+}
+
+double FrameScheduler::Now()
+{
+    // the coarse clock (as in StopWatch) has a resolution of the kernel tick,
+    // which is too rough for measuring frame times
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+void FrameScheduler::Start()
+{
+    _start = _frame_start = _next = _report_start = Now();
+}
+
+void FrameScheduler::BeginFrame()
+{
+    _frame_start = Now();
+}
+
+double FrameScheduler::EndFrame( const bool drawn )
+{
+    const double now = Now();
+    const double budget = 1.0 / _target_fps;
+
+    _frames++;
+    if( drawn ) {
+        const double t = now - _frame_start;
+        _drawn++;
+        _sum_frame_time += t;
+        if( t > _max_frame_time )
+            _max_frame_time = t;
+        if( t > budget )
+            _over_budget++;
+        _undrawn = 0;
+    }
+    else {
+        _undrawn++;
+    }
+
+    // keep polling at the full rate for a while,
+    // new data usually comes in bursts
+    const bool idle = _undrawn > IDLE_AFTER * _target_fps;
+    _next += idle && _idle_fps < _target_fps ? 1.0 / _idle_fps : budget;
+
+    // don't try to catch up with missed frames
+    if( _next < now ) {
+        _next = now;
+        return 0;
+    }
+    return _next - now;
+}
+
+string FrameScheduler::Report()
+{
+    const double now = Now();
+    const double dt = now - _report_start;
+
+    stringstream ss;
+    ss.precision(3);
+    ss << "FPS: " << (dt>0 ? _drawn/dt : 0)
+       << " (" << (dt>0 ? _frames/dt : 0) << " polls/s, target " << _target_fps << ")"
+       << ", frame time avg " << (_drawn>0 ? 1e3*_sum_frame_time/_drawn : 0) << " ms"
+       << ", max " << 1e3*_max_frame_time << " ms"
+       << ", over budget " << _over_budget;
+
+    _report_start = now;
+    _frames = _drawn = _over_budget = 0;
+    _sum_frame_time = _max_frame_time = 0;
+    return ss.str();
+}
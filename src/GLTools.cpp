@@ -2,19 +2,79 @@
 
 const Rectangle Rectangle::unit(-1,-1,1,1);
 
-void Rectangle::_update_vertices()
+VertexBuffer::~VertexBuffer()
 {
-    _vertices[0].x = _center.X() - _width/2.0f;
-    _vertices[0].y = _center.Y() - _height/2.0f;
+    if( _vbo != 0 )
+        glDeleteBuffers(1, &_vbo);
+}
 
-    _vertices[1].x = _center.X() - _width/2.0f;
-    _vertices[1].y = _center.Y() + _height/2.0f;
+void VertexBuffer::Bind()
+{
+    if( _vbo == 0 )
+        glGenBuffers(1, &_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+}
+
+void VertexBuffer::Resize( const size_t n )
+{
+    Bind();
+    glBufferData(GL_ARRAY_BUFFER, n*sizeof(vec2_t), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    _size = n;
+}
 
-    _vertices[2].x = _center.X() + _width/2.0f;
-    _vertices[2].y = _center.Y() + _height/2.0f;
+void VertexBuffer::Set( const vec2_t* v, const size_t n )
+{
+    Bind();
+    if( n > _size ) {
+        glBufferData(GL_ARRAY_BUFFER, n*sizeof(vec2_t), v, GL_DYNAMIC_DRAW);
+        _size = n;
+    }
+    else if( n > 0 ) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, n*sizeof(vec2_t), v);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    _vertices[3].x = _center.X() + _width/2.0f;
-    _vertices[3].y = _center.Y() - _height/2.0f;
+void VertexBuffer::Upload( const vec2_t* v, const size_t offset, const size_t n )
+{
+    if( n == 0 )
+        return;
+    Bind();
+    glBufferSubData(GL_ARRAY_BUFFER, offset*sizeof(vec2_t), n*sizeof(vec2_t), v);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VertexBuffer::Draw( const GLenum mode, const size_t first, const size_t n )
+{
+    if( n == 0 )
+        return;
+    Bind();
+    glVertexPointer(2, GL_FLOAT, 0, 0);
+    glDrawArrays(mode, first, n);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VertexBuffer::TexCoordPointer()
+{
+    // the pointer refers to the buffer bound right now
+    Bind();
+    glTexCoordPointer(2, GL_FLOAT, 0, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+VertexBuffer& Rectangle::UnitVertices()
+{
+    // never deleted, it's needed as long as the GL context exists
+    static VertexBuffer* vbo = NULL;
+    if( vbo == NULL ) {
+        // same order as the texture coordinates
+        const vec2_t v[4] = { {-1,-1}, {-1,1}, {1,1}, {1,-1} };
+        vbo = new VertexBuffer();
+        vbo->Set(v, 4);
+    }
+    return *vbo;
 }
 
 Rectangle::Rectangle(const float x1, const float y1, const float x2, const float y2)
@@ -23,8 +83,6 @@ Rectangle::Rectangle(const float x1, const float y1, const float x2, const float
     _center.Y() = (y1 + y2) / 2.0f;
     _width    = x2 - x1;
     _height   = y2 - y1;
-
-    _update_vertices();
 }
 
 Rectangle::Rectangle( const Vector2& center, 
@@ -32,31 +90,115 @@ Rectangle::Rectangle( const Vector2& center,
                       const float height): 
     _width(width), _height(height), _center(center)
 {
-    _update_vertices();
 }
 
 void Rectangle::SetCenter(const Vector2& center)
 {
     _center = center;
-    _update_vertices();
 }
 
 void Rectangle::SetWidth(const float width)
 {
     _width = width;
-    _update_vertices();
 }
 
 void Rectangle::SetHeight(const float height)
 {
     _height = height;
-    _update_vertices();
 }
 
 void Rectangle::Draw(GLenum mode) const
 {
-    glVertexPointer( 2, GL_FLOAT, 0, _vertices);
-    glDrawArrays( mode, 0, 4);
+    glPushMatrix();
+    glTranslatef(_center.X(), _center.Y(), 0.0f);
+    glScalef(_width/2.0f, _height/2.0f, 1.0f);
+    UnitVertices().Draw(mode, 0, 4);
+    glPopMatrix();
+}
+
+
+FrameBuffer::~FrameBuffer()
+{
+    if( _fbo != 0 ) {
+        glDeleteFramebuffers(1, &_fbo);
+        glDeleteTextures(1, &_tex);
+    }
+}
+
+static int RoundPow2( const int v )
+{
+    int p = 1;
+    while( p < v )
+        p *= 2;
+    return p;
+}
+
+bool FrameBuffer::Begin( const int width, const int height )
+{
+    if( width <= 0 || height <= 0 )
+        return false;
+
+    if( _fbo == 0 ) {
+        glGenFramebuffers(1, &_fbo);
+        glGenTextures(1, &_tex);
+    }
+
+    if( width != _width || height != _height ) {
+        // GLES 1.1 needs power of two textures
+        const int w = RoundPow2(width);
+        const int h = RoundPow2(height);
+        glBindTexture(GL_TEXTURE_2D, _tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _tex, 0);
+        _complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        _width = width;
+        _height = height;
+
+        // the rows start at the bottom, same vertex order as the unit square
+        const float u = (float) width / w;
+        const float v = (float) height / h;
+        _texcoords[0].x = 0; _texcoords[0].y = 0;
+        _texcoords[1].x = 0; _texcoords[1].y = v;
+        _texcoords[2].x = u; _texcoords[2].y = v;
+        _texcoords[3].x = u; _texcoords[3].y = 0;
+    }
+
+    if( !_complete )
+        return false;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glViewport(0, 0, _width, _height);
+    glClear(GL_COLOR_BUFFER_BIT);
+    return true;
+}
+
+void FrameBuffer::End()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, GetWindowWidth(), GetWindowHeight());
+}
+
+void FrameBuffer::Draw() const
+{
+    // copied as it is
+    kWhite.Activate();
+    glBindTexture(GL_TEXTURE_2D, _tex);
+    glTexCoordPointer(2, GL_FLOAT, 0, _texcoords);
+    glEnable(GL_TEXTURE_2D);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    Rectangle::unit.Draw( GL_TRIANGLE_FAN );
+
+    glDisable(GL_TEXTURE_2D);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 }
 
 
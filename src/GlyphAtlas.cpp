@@ -0,0 +1,87 @@
+#include "GlyphAtlas.h"
+#include "TextRenderer.h"
+
+using namespace std;
+
+GlyphAtlas::GlyphAtlas()
+{
+    const string chars = GLYPHATLAS_CHARS;
+    TextRenderer render;
+    render.Glyphs2Texture(_texture, chars, GLYPHATLAS_COLUMNS);
+
+    const size_t rows = (chars.size() + GLYPHATLAS_COLUMNS - 1) / GLYPHATLAS_COLUMNS;
+    _du = _texture.GetMaxU() / GLYPHATLAS_COLUMNS;
+    _dv = _texture.GetMaxV() / rows;
+}
+
+const GlyphAtlas& GlyphAtlas::I()
+{
+    // never deleted, it's needed as long as the GL context exists
+    static GlyphAtlas* atlas = NULL;
+    if( atlas == NULL )
+        atlas = new GlyphAtlas();
+    return *atlas;
+}
+
+bool GlyphAtlas::TexCoords( const char c, vec2_t& top_left, vec2_t& bottom_right ) const
+{
+    // the atlas holds the printable ASCII characters in order
+    if( c < ' ' || c > '~' )
+        return false;
+
+    const int i = c - ' ';
+    top_left.x = (i % GLYPHATLAS_COLUMNS) * _du;
+    top_left.y = (i / GLYPHATLAS_COLUMNS) * _dv;
+    bottom_right.x = top_left.x + _du;
+    bottom_right.y = top_left.y + _dv;
+    return true;
+}
+
+
+void GlyphBatch::Clear()
+{
+    _vertices.clear();
+    _texcoords.clear();
+    _changed = true;
+}
+
+void GlyphBatch::Add( const char c, const float x1, const float y1, const float x2, const float y2 )
+{
+    vec2_t tl, br;
+    if( c == ' ' || !GlyphAtlas::I().TexCoords(c, tl, br) )
+        return;
+
+    // two triangles, the texture's first row is the top
+    const vec2_t v[6] = { {x1,y1}, {x1,y2}, {x2,y2}, {x2,y2}, {x2,y1}, {x1,y1} };
+    const vec2_t t[6] = { {tl.x,br.y}, {tl.x,tl.y}, {br.x,tl.y}, {br.x,tl.y}, {br.x,br.y}, {tl.x,br.y} };
+    _vertices.insert(_vertices.end(), v, v+6);
+    _texcoords.insert(_texcoords.end(), t, t+6);
+    _changed = true;
+}
+
+void GlyphBatch::Draw()
+{
+    if( _changed ) {
+        if( !_vertices.empty() ) {
+            _vbo.Set(&_vertices[0], _vertices.size());
+            _tbo.Set(&_texcoords[0], _texcoords.size());
+        }
+        _changed = false;
+    }
+
+    if( _vertices.empty() )
+        return;
+
+    glEnable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glBlendFunc(GL_SRC_ALPHA,GL_ONE);
+
+    GlyphAtlas::I().Bind();
+    _tbo.TexCoordPointer();
+    _vbo.Draw(GL_TRIANGLES, 0, _vertices.size());
+
+    glDisable(GL_BLEND);
+    glDisable(GL_TEXTURE_2D);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+}
@@ -212,11 +212,17 @@ bool ImageWindow::ApplyTexture(int state)
     return false;
 }
 
-void ImageWindow::Draw()
-{    
+void ImageWindow::Poll()
+{
+    // only a new image (or the failure to load one) changes the window
     if(ApplyTexture(pthread_mutex_trylock(&_mutex_running))) {
         pthread_mutex_unlock(&_mutex_running);
+        SetDirty();
     }
+}
+
+void ImageWindow::Draw()
+{    
              
     glPushMatrix();
     glScalef(.98,.98,.1);
@@ -0,0 +1,78 @@
+#include "MemoryPool.h"
+#include <stdlib.h>
+
+MemoryPool::MemoryPool( const size_t blocksize, const size_t blocks ):
+    _memory(NULL),
+    _blocksize(0),
+    _blocks(blocks),
+    _free(NULL),
+    _hits(0),
+    _misses(0),
+    _used(0),
+    _highwater(0)
+{
+    pthread_mutex_init(&_mutex, NULL);
+
+    // keep the blocks aligned, and large enough
+    // to hold the pointer of the free list
+    const size_t align = sizeof(double) > sizeof(void*) ? sizeof(double) : sizeof(void*);
+    _blocksize = blocksize < align ? align : blocksize;
+    _blocksize = (_blocksize + align - 1) / align * align;
+
+    _memory = (char*)malloc(_blocksize * _blocks);
+
+    // chain all blocks
+    for( size_t i=_blocks; i-- > 0; ) {
+        void* block = _memory + i*_blocksize;
+        *(void**)block = _free;
+        _free = block;
+    }
+}
+
+MemoryPool::~MemoryPool()
+{
+    free(_memory);
+    pthread_mutex_destroy(&_mutex);
+}
+
+bool MemoryPool::Contains( const void* p ) const
+{
+    return p >= _memory && p < _memory + _blocksize*_blocks;
+}
+
+void* MemoryPool::Alloc( const size_t size )
+{
+    pthread_mutex_lock(&_mutex);
+    if( size > _blocksize || _free == NULL ) {
+        _misses++;
+        pthread_mutex_unlock(&_mutex);
+        return malloc(size);
+    }
+
+    void* block = _free;
+    _free = *(void**)block;
+
+    _hits++;
+    _used++;
+    if( _used > _highwater )
+        _highwater = _used;
+    pthread_mutex_unlock(&_mutex);
+    return block;
+}
+
+void MemoryPool::Free( void* p )
+{
+    if( p == NULL )
+        return;
+
+    if( !Contains(p) ) {
+        free(p);
+        return;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    *(void**)p = _free;
+    _free = p;
+    _used--;
+    pthread_mutex_unlock(&_mutex);
+}
@@ -2,7 +2,6 @@
 #include <sstream>
 #include <string>
 #include <iomanip>
-#include "TextRenderer.h"
 #include <algorithm>
 #include <cmath>
 
@@ -67,6 +66,7 @@ std::string NumberLabel::FormatNumberSI(const float& v) {
 
 NumberLabel::NumberLabel(const Window *owner ):
     Widget(owner),
+    _batch_aspect(0),
     _color(dTextColor),
     _prec(2),
     _value(nanf("")),
@@ -74,82 +74,65 @@ NumberLabel::NumberLabel(const Window *owner ):
     _align_right(true),
     _draw_box(true)
 {
-    _maketextures();
 }
 
 NumberLabel::~NumberLabel()
 {
-    --_num_objects;
-
-    if( _num_objects == 0) {
-        delete [] _textures;
-    }
 }
 
-vec2_t NumberLabel::_texcoords[4];
-
-void NumberLabel::Draw() const
+void NumberLabel::Layout( GlyphBatch& batch, const vec2_t& pos, const float scale ) const
 {
-    unsigned char digits = 0;
+    size_t digits = 0;
     if( _align_right ) {
-        digits = max((int)_digits, (int)_digtex.size());
+        digits = max((size_t)_digits, _text.size());
     } else {
-        digits = _digtex.size();
+        digits = _text.size();
     }
 
-    if( digits > 0 ) {
-
-        glPushMatrix();
-
-        glScalef( 1.0f / GetWindowAspect() , _textures[0].GetAspectRatio(), 1.0f );
-
-        if (_draw_box)
-            Box.Draw();
-
-        glScalef(2.0f / (digits * 2.0f), 1.0f, 1.0f );
-
-        glTranslatef( (digits-1), 0.0f, 0.0f);
-
-        glEnable(GL_TEXTURE_2D);
-        glEnable(GL_BLEND);
-        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-        glBlendFunc(GL_SRC_ALPHA,GL_ONE);
-       // glTexCoordPointer(2, GL_FLOAT, 0, _texcoords);
+    if( digits == 0 )
+        return;
 
-        _color.Activate();
+    // the label is 2 wide in window aspect corrected units
+    // and as high as a glyph, the text goes to the right end
+    const float w = scale * 2.0f / GetWindowAspect() / digits;
+    const float h = scale * GlyphAtlas::I().GetAspectRatio();
+    float x = pos.x + scale / GetWindowAspect() - w * _text.size();
 
-        for(size_t p=0; p<_digtex.size(); ++p ) {
-
-            _textures[ _digtex[p] ].Activate();
-            Rectangle::unit.Draw( GL_TRIANGLE_FAN );
-            glTranslatef( -2.0f, 0.0f, 0.0f );
+    for(size_t p=0; p<_text.size(); ++p ) {
+        batch.Add( _text[p], x, pos.y - h, x + w, pos.y + h );
+        x += w;
+    }
+}
 
-        }
+void NumberLabel::Draw() const
+{
+    if( _text.empty() && !_align_right )
+        return;
+
+    if( _batch_aspect != GetWindowAspect() ) {
+        const vec2_t center = {0, 0};
+        _batch.Clear();
+        Layout(_batch, center, 1.0f);
+        _batch_aspect = GetWindowAspect();
+    }
 
+    if (_draw_box) {
+        glPushMatrix();
+        glScalef( 1.0f / GetWindowAspect() , GlyphAtlas::I().GetAspectRatio(), 1.0f );
+        Box.Draw();
         glPopMatrix();
-
-        glDisable(GL_BLEND);
-        glDisable(GL_TEXTURE_2D);
-        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-
     }
 
+    _color.Activate();
+    _batch.Draw();
 }
 
 void NumberLabel::SetString(const std::string &str)
 {
-    _digtex.resize(str.size());
-
-    for(size_t p=0; p< str.size(); ++p) {
-
-        const char& c = str[p];
-        unsigned char texnum;
-
-        texnum = c - 32;
-
-        _digtex[str.size() - p-1] = texnum;
-
-    }
+    if( str == _text )
+        return;
+    _text = str;
+    _batch_aspect = 0;
 }
 
 void NumberLabel::SetPrec(const unsigned short prec)
@@ -189,31 +172,3 @@ void NumberLabel::SetTime( float s) {
     SetString(text.str());
 
 }
-
-
-
-unsigned int NumberLabel::_num_objects = 0;
-Texture* NumberLabel::_textures(NULL);
-float NumberLabel::_texratio = 1.0;
-
-void NumberLabel::_maketextures()
-{
-
-    if(_num_objects==0) {
-        cout << "make tex" << endl;
-
-        _textures = new Texture[NUMBERLABEL_NUM_TEX];
-
-        const char chars[] = NUMBERLABEL_CHARS;
-
-        TextRenderer render;
-        for( int i=0; i<NUMBERLABEL_NUM_TEX; ++i ) {
-            stringstream s;
-            s << chars[i];
-            render.Text2Texture( _textures[i], s.str());
-        }
-
-    }
-    _num_objects++;
-
-}
@@ -0,0 +1,155 @@
+#include <string.h>
+#include "PVLog.h"
+
+using namespace std;
+
+PVLogWriter::PVLogWriter(): _file(NULL)
+{
+    pthread_mutex_init(&_mutex, NULL);
+}
+
+PVLogWriter::~PVLogWriter()
+{
+    Close();
+    pthread_mutex_destroy(&_mutex);
+}
+
+bool PVLogWriter::Open(const string& filename)
+{
+    FILE* f = fopen(filename.c_str(), "wb");
+    if(f == NULL)
+        return false;
+    fwrite(PVLOG_MAGIC, 1, strlen(PVLOG_MAGIC), f);
+
+    pthread_mutex_lock(&_mutex);
+    if(_file != NULL)
+        fclose(_file);
+    _file = f;
+    pthread_mutex_unlock(&_mutex);
+    return true;
+}
+
+void PVLogWriter::Close()
+{
+    pthread_mutex_lock(&_mutex);
+    if(_file != NULL)
+        fclose(_file);
+    _file = NULL;
+    pthread_mutex_unlock(&_mutex);
+}
+
+bool PVLogWriter::IsOpen()
+{
+    pthread_mutex_lock(&_mutex);
+    const bool open = _file != NULL;
+    pthread_mutex_unlock(&_mutex);
+    return open;
+}
+
+template<typename T>
+static void Append(vector<char>& buf, const T& v)
+{
+    const char* p = (const char*)&v;
+    buf.insert(buf.end(), p, p+sizeof(T));
+}
+
+static void AppendString(vector<char>& buf, const char* s)
+{
+    size_t n = s == NULL ? 0 : strlen(s);
+    if(n > 255)
+        n = 255;
+    Append(buf, (uint8_t)n);
+    buf.insert(buf.end(), s, s+n);
+}
+
+void PVLogWriter::Write(const uint8_t type, const string& name, const char* attr,
+                        const int16_t severity, const double time, const double x, const double y,
+                        const void* data, const size_t nBytes)
+{
+    pthread_mutex_lock(&_mutex);
+    if(_file == NULL) {
+        pthread_mutex_unlock(&_mutex);
+        return;
+    }
+
+    // the buffer keeps its capacity, so it's
+    // hardly ever allocated after the first records
+    _buffer.clear();
+    Append(_buffer, (uint32_t)0); // the length, see below
+    Append(_buffer, type);
+    AppendString(_buffer, name.c_str());
+    AppendString(_buffer, attr);
+    Append(_buffer, severity);
+    Append(_buffer, time);
+    Append(_buffer, x);
+    Append(_buffer, y);
+    const char* p = (const char*)data;
+    _buffer.insert(_buffer.end(), p, p+nBytes);
+
+    const uint32_t length = _buffer.size() - sizeof(uint32_t);
+    memcpy(&_buffer[0], &length, sizeof(length));
+    fwrite(&_buffer[0], 1, _buffer.size(), _file);
+    pthread_mutex_unlock(&_mutex);
+}
+
+
+PVLogReader::~PVLogReader()
+{
+    if(_file != NULL)
+        fclose(_file);
+}
+
+bool PVLogReader::Open(const string& filename)
+{
+    _file = fopen(filename.c_str(), "rb");
+    if(_file == NULL)
+        return false;
+    char magic[sizeof(PVLOG_MAGIC)-1];
+    return fread(magic, 1, sizeof(magic), _file) == sizeof(magic)
+            && memcmp(magic, PVLOG_MAGIC, sizeof(magic)) == 0;
+}
+
+template<typename T>
+static bool Extract(const vector<char>& buf, size_t& pos, T& v)
+{
+    if(pos + sizeof(T) > buf.size())
+        return false;
+    memcpy(&v, &buf[pos], sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+static bool ExtractString(const vector<char>& buf, size_t& pos, string& s)
+{
+    uint8_t n;
+    if(!Extract(buf, pos, n) || pos + n > buf.size())
+        return false;
+    s.assign(&buf[pos], n);
+    pos += n;
+    return true;
+}
+
+bool PVLogReader::Next(PVLogRecord& r)
+{
+    if(_file == NULL)
+        return false;
+
+    uint32_t length;
+    if(fread(&length, sizeof(length), 1, _file) != 1)
+        return false;
+    _buffer.resize(length);
+    if(length > 0 && fread(&_buffer[0], 1, length, _file) != length)
+        return false;
+
+    size_t pos = 0;
+    if(!Extract(_buffer, pos, r.type)
+            || !ExtractString(_buffer, pos, r.name)
+            || !ExtractString(_buffer, pos, r.attr)
+            || !Extract(_buffer, pos, r.severity)
+            || !Extract(_buffer, pos, r.time)
+            || !Extract(_buffer, pos, r.x)
+            || !Extract(_buffer, pos, r.y))
+        return false;
+    r.data.assign(_buffer.begin()+pos, _buffer.end());
+    return true;
+}
@@ -10,52 +10,92 @@
 
 using namespace std;
 
-#define AVG_FRAMES 200
+// seconds between the frame statistics on stdout
+#define REPORT_INTERVAL 10.0
 
-void PiGLETApp::Draw(){
+bool PiGLETApp::Draw(){
+
+    _scheduler.BeginFrame();
        
-    // Start with a clear screen
+    // the screen is cleared by the WindowManager,
+    // if everything is drawn again
     glClearColor(.1,.1,.1,0);
-    glClear( GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
     glLoadIdentity();
     glLineWidth(3);
 
     // draw the stuff, 
     // but don't let the config manager interfere
     ConfigManager::I().MutexLock();    
-    windowman.Draw();
+    _drawn = windowman.Draw(IsBufferPreserved());
     ConfigManager::I().MutexUnlock();
        
     // check if there are callbacks from the telnet
-    // to be executed
-    ConfigManager::I().ExecutePendingCallback();
+    // to be executed, they might change any window
+    if(ConfigManager::I().ExecutePendingCallback())
+        windowman.SetDamaged();
     ReportGLError();
-    
-    frames++;
-    if(frames % AVG_FRAMES == 0) {
-        frames_timer.Stop();        
-        
-        fps = AVG_FRAMES/(frames_timer.TimeElapsed()-timeElapsed);
-        cout << " FPS: " << fps << endl;
-        
-        timeElapsed = frames_timer.TimeElapsed();
+
+    return _drawn;
+}
+
+double PiGLETApp::EndFrame()
+{
+    const double wait = _scheduler.EndFrame(_drawn);
+    if(GetRoughTime() >= _next_report) {
+        cout << _scheduler.Report() << endl;
+        _next_report = GetRoughTime() + REPORT_INTERVAL;
     }
+    return wait;
+}
+
+static string ParseFPS(const string& arg, double& fps)
+{
+    stringstream ss(arg);
+    double v;
+    if(!(ss >> v) || v <= 0)
+        return "Value must be a positive number";
+    fps = v;
+    return ""; // success
+}
+
+string PiGLETApp::callbackSetTargetFPS(const string& arg)
+{
+    double fps;
+    const string err = ParseFPS(arg, fps);
+    if(err.empty())
+        _scheduler.SetTargetFPS(fps);
+    return err;
 }
 
+string PiGLETApp::callbackSetIdleFPS(const string& arg)
+{
+    double fps;
+    const string err = ParseFPS(arg, fps);
+    if(err.empty())
+        _scheduler.SetIdleFPS(fps);
+    return err;
+}
 
-double PiGLETApp::GetRoughTime()
+string PiGLETApp::callbackSetSwapInterval(const string& arg)
 {
-    return timeElapsed +
-            (frames % AVG_FRAMES)/fps;
+    stringstream ss(arg);
+    int interval;
+    if(!(ss >> interval) || interval < 0)
+        return "Value must be a non-negative integer";
+    if(!SetSwapInterval(interval))
+        return "Swap interval not supported";
+    return ""; // success
 }
 
 void PiGLETApp::Init(){
     prctl(PR_SET_NAME, "PiGLET", 0l, 0l, 0l);
     cout << "Starting PiGLET..." << endl;
-    frames_timer.Start();
-    frames = 0;
-    timeElapsed = 0.0;
-    fps = 25.0; // some guess for initial frames
+    _scheduler.Start();
+    _next_report = REPORT_INTERVAL;
+
+    ConfigManager::I().addCmd("TargetFPS", BIND_MEM_CB(&PiGLETApp::callbackSetTargetFPS, this));
+    ConfigManager::I().addCmd("IdleFPS", BIND_MEM_CB(&PiGLETApp::callbackSetIdleFPS, this));
+    ConfigManager::I().addCmd("SwapInterval", BIND_MEM_CB(&PiGLETApp::callbackSetSwapInterval, this));
         
 //    for (int i = 0 ; i < 1; i++){
 //        stringstream ss;
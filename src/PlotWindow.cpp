@@ -14,16 +14,22 @@ PlotWindow::PlotWindow(
         const std::string& xlabel,
         const std::string& ylabel,
         const float xscale,
-        const float yscale ) :
-    Window(owner, pvname,xscale,yscale),
+        const float yscale,
+        const std::string& name ) :
+    Window(owner, name.empty() ? pvname : name, xscale, yscale),
     _pvname(pvname),
+    _pv(NULL),
     _xlabel(xlabel),
     _ylabel(ylabel),    
     _initialized(false),
     WindowArea( dBackColor, dWindowBorderColor),
     graph(this, 60), // DEFAULT_BACKLEN 60
     text(this, -0.98, .66, .99, .98),
+    _static_valid(false),
     frame(0),
+    _min_interval(0),
+    _deadband(0),
+    _deadband_rel(0),
     _epics_connected(false),
     discon_lbl(this, -.1, -.1, .8, .9)
 {
@@ -42,10 +48,14 @@ int PlotWindow::Init()
         return 1;
     
     ConfigManager::I().addCmd(Name()+"_BackLength", BIND_MEM_CB(&PlotWindow::callbackSetBackLength, this));    
+    ConfigManager::I().addCmd(Name()+"_AbsoluteTime", BIND_MEM_CB(&PlotWindow::callbackSetAbsoluteTime, this));
+    ConfigManager::I().addCmd(Name()+"_MinInterval", BIND_MEM_CB(&PlotWindow::callbackSetMinInterval, this));
+    ConfigManager::I().addCmd(Name()+"_Deadband", BIND_MEM_CB(&PlotWindow::callbackSetDeadband, this));
+    ConfigManager::I().addCmd(Name()+"_DeadbandRel", BIND_MEM_CB(&PlotWindow::callbackSetDeadbandRel, this));
     
     int ret = Window::Init();
     // the provided cb is triggered via processNewDataForPV    
-    Epics::I().addPV(_pvname, BIND_MEM_CB(&PlotWindow::ProcessEpicsData, this));     
+    _pv = Epics::I().addPV(_pvname, BIND_MEM_CB(&PlotWindow::ProcessEpicsData, this));     
     // return & save status for dtor    
     _initialized = ret == 0;
     return ret;
@@ -53,27 +63,94 @@ int PlotWindow::Init()
 
 PlotWindow::~PlotWindow() {
     if(_initialized) {
-        Epics::I().removePV(_pvname);      
+        Epics::I().removePV(_pv);      
     }
-    ConfigManager::I().removeCmd(_pvname+"_BackLength");
+    ConfigManager::I().removeCmd(Name()+"_BackLength");
+    ConfigManager::I().removeCmd(Name()+"_AbsoluteTime");
+    ConfigManager::I().removeCmd(Name()+"_MinInterval");
+    ConfigManager::I().removeCmd(Name()+"_Deadband");
+    ConfigManager::I().removeCmd(Name()+"_DeadbandRel");
     //cout << "Plotwindow dtor" << endl;
 } 
 
 string PlotWindow::callbackSetBackLength(const string& arg){
-    graph.SetBackLength(atoi(arg.c_str()));
+    SetBackLength(atoi(arg.c_str()));
     return ""; // success
 }
 
-void PlotWindow::Draw() {
-    
+string PlotWindow::callbackSetAbsoluteTime(const string& arg){
+    stringstream ss(arg);
+    int absolute;
+    if(!(ss >> absolute))
+        return "Value must be 0 or 1";
+    graph.SetAbsoluteTime(absolute != 0, Epics::I().GetStartTime());
+    return ""; // success
+}
+
+string PlotWindow::SetFilter(const string& arg, double& value)
+{
+    stringstream ss(arg);
+    double v;
+    if(!(ss >> v) || v < 0)
+        return "Value must be a non-negative number";
+    value = v;
+    if(_initialized)
+        Epics::I().SetFilter(_pv, _min_interval, _deadband, _deadband_rel);
+    return ""; // success
+}
+
+string PlotWindow::callbackSetMinInterval(const string& arg){
+    return SetFilter(arg, _min_interval);
+}
+
+string PlotWindow::callbackSetDeadband(const string& arg){
+    return SetFilter(arg, _deadband);
+}
+
+string PlotWindow::callbackSetDeadbandRel(const string& arg){
+    return SetFilter(arg, _deadband_rel);
+}
+
+void PlotWindow::Poll() {
+
     graph.SetNow(Epics::I().GetCurrentTime());
-    Epics::I().processNewDataForPV(_pvname);   
-    
-   
+    // every item changes something
+    Epics::I().processNewDataForPV(_pv);
+    if(graph.Damaged())
+        SetDirty();
+}
+
+void PlotWindow::DrawStatic() {
+
     // Window border
     WindowArea.Draw();
-    graph.Draw();
+    graph.DrawStatic();
     text.Draw();
+}
+
+void PlotWindow::Draw() {
+
+    if( graph.StaticChanged() )
+        _static_valid = false;
+
+    // the layer covers the whole window,
+    // drawn in the window's coordinates
+    if( !_static_valid && _static_layer.Begin((int)(XPixels()+.5f), (int)(YPixels()+.5f)) ) {
+        glPushMatrix();
+            glLoadIdentity();
+            DrawStatic();
+        glPopMatrix();
+        _static_layer.End();
+        _static_valid = true;
+    }
+
+    // without framebuffer objects everything is drawn each time
+    if( _static_valid )
+        _static_layer.Draw();
+    else
+        DrawStatic();
+
+    graph.DrawLive();
 
     if( !_epics_connected ) {
         discon_lbl.Draw();
@@ -84,6 +161,8 @@ void PlotWindow::Draw() {
 
 void PlotWindow::ProcessEpicsData(const Epics::DataItem* i) {
 
+    SetDirty();
+
     // if new, process it!
     switch (i->type) {
     case Epics::Connected:
@@ -102,20 +181,27 @@ void PlotWindow::ProcessEpicsData(const Epics::DataItem* i) {
         break;
         
     case Epics::NewValue: {
-        vec2_t* d = (vec2_t*)i->data;
-        graph.AddToBlockList(*d);     
+        graph.AddToBlockList(i->value);     
         break;               
     }
     case Epics::NewProperties: {
         ProcessEpicsProperties(i->attr, i->data);
         break;
     }
+    case Epics::NewWaveform:
+        // we subscribe to scalars only
+        break;
     }        
     
 }
 
 void PlotWindow::ProcessEpicsProperties(const string& attr, void* d) {
-    
+
+    // the severity only colors the value, which is drawn live,
+    // the title, limits and precision go into the static layer
+    if(attr != "SEVR")
+        _static_valid = false;
+
     if(attr == "HIHI") {
         graph.SetMajorAlarmsMax(*(dbr_double_t*)d);
     }
@@ -161,6 +247,9 @@ void PlotWindow::ProcessEpicsProperties(const string& attr, void* d) {
 void PlotWindow::Update() 
 { 
     graph.UpdateTicks(); 
+    // the size might have changed
+    _static_valid = false;
+    SetDirty();
 }
 
 
@@ -0,0 +1,232 @@
+#include <iostream>
+#include <string.h>
+#include <time.h>
+#include "ReplaySource.h"
+
+using namespace std;
+
+// the items of a PV's queue the replay leaves to the
+// producers of the connection and properties, in fast mode
+#define REPLAY_QUEUE_LIMIT (EPICS_QUEUE_SIZE - 2*EPICS_QUEUE_RESERVED)
+
+// the attributes must stay valid after injecting them
+static const char* attributes[] = {
+    "HIHI", "HIGH", "LOW", "LOLO", "SEVR", "HOPR", "LOPR", "EGU", "PREC"
+};
+static const size_t n_attributes = sizeof(attributes)/sizeof(attributes[0]);
+
+static void Sleep(const double s) {
+    timespec t;
+    t.tv_sec = (time_t)s;
+    t.tv_nsec = (long)(1e9*(s - t.tv_sec));
+    nanosleep(&t, NULL);
+}
+
+ReplaySource::ReplaySource(const bool fast):
+    _fast(fast),
+    _started(false),
+    _stop(false)
+{
+    pthread_mutex_init(&_mutex, NULL);
+}
+
+ReplaySource::~ReplaySource()
+{
+    if(_started) {
+        _stop = true;
+        pthread_join(_thread, NULL);
+    }
+    pthread_mutex_destroy(&_mutex);
+}
+
+bool ReplaySource::Subscribe(const string& pvname, Epics::Producer p)
+{
+    pthread_mutex_lock(&_mutex);
+    Subscription& sub = _pvs[pvname];
+    sub.producer = p;
+    // the PV may be in the log already
+    sub.refresh = true;
+    sub.fresh = true;
+    if(!_started) {
+        pthread_create(&_thread, 0, &ReplaySource::start_thread, this);
+        _started = true;
+    }
+    pthread_mutex_unlock(&_mutex);
+    return true;
+}
+
+void ReplaySource::Refresh(Epics::Producer p)
+{
+    // only the thread injects, so it does it before the next record
+    pthread_mutex_lock(&_mutex);
+    for(map<string, Subscription>::iterator it = _pvs.begin(); it != _pvs.end(); ++it) {
+        if(it->second.producer == p)
+            it->second.refresh = true;
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+void ReplaySource::Unsubscribe(Epics::Producer p)
+{
+    // the thread holds the mutex while injecting
+    pthread_mutex_lock(&_mutex);
+    for(map<string, Subscription>::iterator it = _pvs.begin(); it != _pvs.end(); ++it) {
+        if(it->second.producer == p) {
+            _pvs.erase(it);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+static const char* Attribute(const string& attr)
+{
+    for(size_t i=0;i<n_attributes;i++) {
+        if(attr == attributes[i])
+            return attributes[i];
+    }
+    return NULL;
+}
+
+void ReplaySource::Update(State& s, const PVLogRecord& r, const double t)
+{
+    switch(r.type) {
+    case Epics::Connected:
+    case Epics::Disconnected:
+        s.connected = r.type == Epics::Connected;
+        break;
+    case Epics::NewValue:
+        s.has_value = true;
+        s.time = t;
+        s.value = r.y;
+        s.severity = r.severity;
+        break;
+    case Epics::NewProperties:
+        if(Attribute(r.attr) != NULL && !r.data.empty())
+            s.properties[r.attr] = r.data;
+        break;
+    default:
+        break;
+    }
+}
+
+void ReplaySource::Inject(Epics::Producer p, const PVLogRecord& r, const double t)
+{
+    switch(r.type) {
+    case Epics::Connected:
+    case Epics::Disconnected:
+        Epics::I().InjectConnection(p, r.type == Epics::Connected);
+        break;
+    case Epics::NewValue:
+        Epics::I().InjectValue(p, t, r.y, r.severity);
+        break;
+    case Epics::NewProperties: {
+        const char* attr = Attribute(r.attr);
+        if(attr != NULL && !r.data.empty())
+            Epics::I().InjectProperty(p, attr, &r.data[0], r.data.size());
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void ReplaySource::InjectState(Epics::Producer p, const State& s, const bool connect)
+{
+    // a disconnected PV has nothing to tell,
+    // the consumers joining later are told by Epics
+    if(!s.connected)
+        return;
+    if(connect)
+        Epics::I().InjectConnection(p, true);
+    for(map<string, vector<char> >::const_iterator it = s.properties.begin(); 
+        it != s.properties.end(); ++it) {
+        Epics::I().InjectProperty(p, Attribute(it->first), &it->second[0], it->second.size());
+    }
+    if(s.has_value)
+        Epics::I().InjectValue(p, s.time, s.value, s.severity);
+}
+
+void ReplaySource::Refreshes()
+{
+    for(map<string, Subscription>::iterator it = _pvs.begin(); it != _pvs.end(); ++it) {
+        if(!it->second.refresh)
+            continue;
+        it->second.refresh = false;
+        map<string, State>::const_iterator s = _states.find(it->first);
+        if(s != _states.end())
+            InjectState(it->second.producer, s->second, it->second.fresh);
+        it->second.fresh = false;
+    }
+}
+
+void ReplaySource::do_work()
+{
+    PVLogRecord r;
+    bool first = true;
+    double offset = 0;  // from the recorded to the current time
+    size_t records = 0;
+
+    while(!_stop && _log.Next(r)) {
+        if(first) {
+            offset = Epics::I().GetCurrentTime() - r.time;
+            first = false;
+        }
+
+        // wait until it's due, but check for stopping 
+        // and new consumers now and then
+        if(!_fast) {
+            double wait;
+            while(!_stop && (wait = r.time + offset - Epics::I().GetCurrentTime()) > 0) {
+                pthread_mutex_lock(&_mutex);
+                Refreshes();
+                pthread_mutex_unlock(&_mutex);
+                Sleep(wait < 0.01 ? wait : 0.01);
+            }
+        }
+
+        // in fast mode, the data arrives right now
+        const double t = _fast ? Epics::I().GetCurrentTime() : r.x + offset;
+
+        pthread_mutex_lock(&_mutex);
+        Refreshes();
+        map<string, Subscription>::iterator it = _pvs.find(r.name);
+        if(it != _pvs.end()) {
+            // don't drop anything, wait until the consumer catches up
+            while(_fast && !_stop && Epics::I().Pending(it->second.producer) >= REPLAY_QUEUE_LIMIT) {
+                pthread_mutex_unlock(&_mutex);
+                Sleep(1e-3);
+                pthread_mutex_lock(&_mutex);
+                Refreshes();
+                it = _pvs.find(r.name);
+                if(it == _pvs.end())
+                    break;
+            }
+            if(it != _pvs.end() && !_stop)
+                Inject(it->second.producer, r, t);
+        }
+        // after injecting, so a refresh in between doesn't send it twice
+        map<string, State>::iterator s = _states.find(r.name);
+        if(s == _states.end()) {
+            State empty;
+            empty.connected = false;
+            empty.has_value = false;
+            empty.time = 0;
+            empty.value = 0;
+            empty.severity = 0;
+            s = _states.insert(make_pair(r.name, empty)).first;
+        }
+        Update(s->second, r, t);
+        pthread_mutex_unlock(&_mutex);
+        records++;
+    }
+    cout << "Replay finished after " << records << " records" << endl;
+
+    // the PVs added later still get the final state
+    while(!_stop) {
+        pthread_mutex_lock(&_mutex);
+        Refreshes();
+        pthread_mutex_unlock(&_mutex);
+        Sleep(0.01);
+    }
+}
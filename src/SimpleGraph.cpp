@@ -2,6 +2,9 @@
 #include "Window.h"
 #include <cmath>
 #include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <ctime>
 #include "Sound.h"
 #include "PiGLETApp.h"
 
@@ -19,6 +22,15 @@ float SimpleGraph::GetYGlobal(const float y)
 
 SimpleGraph::SimpleGraph( Window* owner, const float backlength ):
     Widget(owner),
+    _xaxis(owner),
+    _yaxis(owner),
+    _absolute_time(false),
+    _start_time(0),
+    _now(0),
+    _xtick_dx(0),
+    _xtick_first(0),
+    _xtick_last(-1),
+    _xtick_base(0),
     _blocklist(backlength),
     _yrange(),
     _yrange_manual(),
@@ -29,13 +41,15 @@ SimpleGraph::SimpleGraph( Window* owner, const float backlength ):
     PlotArea( dPlotBackground, dPlotBorderColor),
     _minorAlarm(dMinorAlarm),
     _majorAlarm(dMajorAlarm),    
+    _drawn_scroll(0),
+    _static_changed(true),
     TickColor(dPlotTicks),
     TickLabelColor(dPlotTickLabels),
     StartLineColor(dStartLineColor),
     enable_lastline(false)
 {
     _time_since_noalarm = PiGLETApp::I().GetRoughTime()-ALARM_DECAY_TIME;    
-    vec2_t init;
+    dvec2_t init;
     init.x = 0./0.;
     init.y = 0./0.;
     _lastline[0] = init;
@@ -45,16 +59,15 @@ SimpleGraph::SimpleGraph( Window* owner, const float backlength ):
 
 SimpleGraph::~SimpleGraph()
 {
-    DeleteTicks();
 }
 
-void SimpleGraph::AddToBlockList(const vec2_t &p)
+void SimpleGraph::AddToBlockList(const dvec2_t &p)
 {
     // check if we had a previous value,
     // then add it with the new x, but old y to
     // create a "stepped" plotting (instead of linear slope)    
     if(!isnan(_lastline[0].x)) {
-        vec2_t p_old = p;
+        dvec2_t p_old = p;
         p_old.y = _lastline[0].y;
         _blocklist.Add(p_old);
     }
@@ -76,78 +89,107 @@ void SimpleGraph::NewBlock()
     _blocklist.NewBlock(false);
 }
 
-void SimpleGraph::Draw()
+bool SimpleGraph::Damaged()
 {
+    bool damaged = false;
+
     // set the fading/blinking color of the ValueDisplay
-    
+    Color c = _curr_color;
     double timeElapsed = PiGLETApp::I().GetRoughTime() - _time_since_noalarm;
     if(timeElapsed<ALARM_DECAY_TIME) {
-        if((int)(3*timeElapsed) % 2 == 0) {
-            ValueDisplay.SetColor(_curr_color);
-        }
-        else {
-            ValueDisplay.SetColor(_prev_color);
+        if((int)(3*timeElapsed) % 2 != 0) {
+            c = _prev_color;
         }
     }
-    else {
-        ValueDisplay.SetColor(_curr_color);
+    if( c != ValueDisplay.GetColor() ) {
+        ValueDisplay.SetColor(c);
+        damaged = true;
     }
-    
 
-    
+    // the trace and the ticks move by whole pixels
+    const float scroll = floor( _blocklist.XRange().Max() / _blocklist.XRange().Length() * _owner->XPixels() );
+    if( scroll != _drawn_scroll ) {
+        _drawn_scroll = scroll;
+        damaged = true;
+    }
+
+    return damaged;
+}
+
+static const float scale_y = 0.72f;
+static const float scale_x = 0.8f;
+
+void SimpleGraph::Draw()
+{
+    DrawStatic();
+    DrawLive();
+}
+
+bool SimpleGraph::StaticChanged()
+{
+    const bool changed = _static_changed;
+    _static_changed = false;
+    return changed;
+}
+
+void SimpleGraph::DrawStatic()
+{
     glPushMatrix();
-        const float scale_y = 0.72f;
-        const float scale_x = 0.8f;
         glTranslatef(-.08, -.12, 0);
         glScalef(scale_x, scale_y, 1.0f);
-        //glScalef(scale_x, 1.0f, 1.0f);
 
         PlotArea.Draw();
-        DrawTicks();
 
-      
+        _yaxis.Draw( TickColor, TickLabelColor, GetWindowAspect() );
+        if( !_absolute_time )
+            _xaxis.Draw( TickColor, TickLabelColor, GetWindowAspect() );
 
-        // limit draw area to plot area box
-        glEnable(GL_STENCIL_TEST);
-        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-        glStencilFunc(GL_NEVER, 1, 0xFF);
-        glStencilOp(GL_REPLACE, GL_KEEP, GL_KEEP);  // draw 1s on test fail (always)
+        // only levels inside the plot area are drawn
+        _minorAlarm.Draw();
+        _majorAlarm.Draw();
 
-        // draw stencil pattern
-        glStencilMask(0xFF);
-        glClear(GL_STENCIL_BUFFER_BIT);  // needs mask=0xFF
+    glPopMatrix();
+}
 
-        PlotArea.Draw();
+void SimpleGraph::DrawLive()
+{
+    glPushMatrix();
+        glTranslatef(-.08, -.12, 0);
+        glScalef(scale_x, scale_y, 1.0f);
+
+        if( _absolute_time )
+            DrawScrollingTicks();
+
+        // limit draw area to plot area box,
+        // it's a rectangle so no stencil is needed
+        _owner->Scissor( -.08f - scale_x, -.12f - scale_y, -.08f + scale_x, -.12f + scale_y );
 
-        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-        glStencilMask(0x00);
-        glStencilFunc(GL_EQUAL, 1, 0xFF);
-        // draw area is now limited
-        
-        
-        _minorAlarm.Draw();
-        _majorAlarm.Draw();
-       
         glPushMatrix();
 
             // change to graph coordinates
             glScalef( 2.0f / _blocklist.XRange().Length(), 2.0f /  _yrange.Length(), 1.0f );
             glTranslatef(-_blocklist.XRange().Center(), -_yrange.Center(), 0.0f );
 
-            _blocklist.Draw();
+            // the static layer may have changed the width or not,
+            // everything drawn with lines sets its width
+            glLineWidth(TRACE_LINEWIDTH);
+
+            // about 2 vertices per pixel of the plot area
+            _blocklist.Draw( scale_x * _owner->XPixels() );
 
             if(enable_lastline) {
                 StartLineColor.Activate();
-                glVertexPointer(2,GL_FLOAT,0, _lastline);
+                vec2_t lastline[2];
+                lastline[0] = _blocklist.ToVertex(_lastline[0]);
+                lastline[1] = _blocklist.ToVertex(_lastline[1]);
+                glVertexPointer(2,GL_FLOAT,0, lastline);
                 glDrawArrays(GL_LINES,0,2);
             }
 
         glPopMatrix();  // ed of graph coordinates
 
         // stop limiting draw area
-        glDisable(GL_STENCIL_TEST);
-
-
+        glDisable(GL_SCISSOR_TEST);
 
         glPushMatrix();
             glTranslatef(-.7,.75,0);
@@ -155,10 +197,7 @@ void SimpleGraph::Draw()
             ValueDisplay.Draw();
         glPopMatrix();
 
-
-
     glPopMatrix();
-
 }
 
 void SimpleGraph::SetYRange(const Interval &yrange)
@@ -172,7 +211,7 @@ void SimpleGraph::SetYRange(const Interval &yrange)
     _yrange = yrange;
     
     
-    UpdateTicks();
+    UpdateYTicks();
 
     // update alarm levels yranges by explicitly setting them
     SetMinorAlarms(_minorAlarm.Levels());
@@ -181,18 +220,26 @@ void SimpleGraph::SetYRange(const Interval &yrange)
 
 void SimpleGraph::SetAutoRange(const bool autorange)
 {
+    const bool changed = autorange != _autorange;
     _autorange = autorange;
     
     if( _autorange ) {
-        Interval y = _blocklist.YRange();
-        if( _yrange.Length() == 0 || y != _yrange ) {
-            float scale = y.Length()>abs(y.Max()) ? y.Length() : abs(y.Max());
-            float len = 0.1*scale;
-            if(len <= 1.0) {
-                len = 1.0;
-            }
-            y.Extend(y.Max()+len);
-            y.Extend(y.Min()-len);
+        // the blocklist keeps its range up-to-date
+        const Interval data = _blocklist.YRange();
+        Interval y = data;
+        float scale = y.Length()>abs(y.Max()) ? y.Length() : abs(y.Max());
+        float len = 0.1*scale;
+        if(len <= 1.0) {
+            len = 1.0;
+        }
+        y.Extend(y.Max()+len);
+        y.Extend(y.Min()-len);
+
+        // hysteresis: only grow when the data leaves the range
+        // and only shrink when the range got much too large
+        const bool outside = !_yrange.Contains(data.Min()) || !_yrange.Contains(data.Max());
+        const bool shrink = y.Length() < AUTORANGE_SHRINK * _yrange.Length();
+        if( changed || _yrange.Length() == 0 || outside || shrink ) {
             SetYRange(y);
         }
     }
@@ -222,6 +269,7 @@ void SimpleGraph::SetMinorAlarms(const Interval &minoralarm )
                     GetYGlobal(minoralarm.Max())
                     )
                 );
+    _static_changed = true;
 }
 
 void SimpleGraph::SetMinorAlarmsMin(const double val)
@@ -243,6 +291,7 @@ void SimpleGraph::SetMajorAlarms(const Interval &majoralarm)
                     GetYGlobal(majoralarm.Max())
                     )
                 );
+    _static_changed = true;
 }
 
 void SimpleGraph::SetMajorAlarmsMin(const double val)
@@ -288,9 +337,9 @@ void SimpleGraph::SetAlarm(const epicsAlarmSeverity serv )
 
 // --------- Ticks ----------
 
-SimpleGraph::TickLabel::TickLabel(const Window *owner, const vec2_t &pos, const float v, const Color& color ):
+SimpleGraph::TickLabel::TickLabel(const Window *owner, const Color& color ):
     NumberLabel(owner),
-    position(pos)
+    _tick(nanf(""))
 {
     SetColor( color );
     SetDrawBox(false);
@@ -299,47 +348,208 @@ SimpleGraph::TickLabel::TickLabel(const Window *owner, const vec2_t &pos, const
     SetPrec(2);
 }
 
+void SimpleGraph::TickLabel::PlaceTime(const vec2_t &pos, const float v)
+{
+    position = pos;
+    if( v != _tick ) {
+        _tick = v;
+        SetTime(v);
+    }
+}
 
-void SimpleGraph::TickLabel::Draw() const
+void SimpleGraph::TickLabel::PlaceNumber(const vec2_t &pos, const float v)
 {
-    glPushMatrix();
-        glTranslatef( position.x, position.y, 0.0f );
-        glScalef( .2f, .2f, .2f);
-        NumberLabel::Draw();
-    glPopMatrix();
+    position = pos;
+    if( v != _tick ) {
+        _tick = v;
+        SetNumber(v);
+    }
+}
+
+void SimpleGraph::TickLabel::PlaceClock(const vec2_t &pos, const double v, const float dx)
+{
+    position = pos;
+    if( v == _tick )
+        return;
+    _tick = v;
+
+    const time_t sec = floor(v);
+    struct tm t;
+    localtime_r(&sec, &t);
+    char buf[16];
+    if( dx >= 60 ) {
+        strftime(buf, sizeof(buf), "%H:%M", &t);
+        SetString(buf);
+    }
+    else if( dx >= 1 ) {
+        strftime(buf, sizeof(buf), "%H:%M:%S", &t);
+        SetString(buf);
+    }
+    else {
+        // the hour is dropped to keep the label short
+        strftime(buf, sizeof(buf), "%M:%S", &t);
+        stringstream text;
+        text << buf << "." << setw(2) << setfill('0') << min(99, (int) floor((v - sec)*100 + .5));
+        SetString(text.str());
+    }
+}
+
+
+SimpleGraph::TickAxis::TickAxis(const Window *owner):
+    _glyphs_aspect(0)
+{
+    for( int i=0; i<NTICKSMAX; ++i )
+        _pool.push_back(new TickLabel(owner));
 }
 
+SimpleGraph::TickAxis::~TickAxis()
+{
+    for( size_t i=0; i<_pool.size(); ++i )
+        delete _pool[i];
+}
 
-void SimpleGraph::DrawTicks() const
+void SimpleGraph::TickAxis::Clear()
 {
+    _shown.clear();
+    _lines.clear();
+    _glyphs_aspect = 0;
+}
 
-     //Draw all tick lines
-    TickColor.Activate();
-    glVertexPointer(2, GL_FLOAT, 0, _ticks.data());
-    glDrawArrays(GL_LINES, 0, _ticks.size());
+SimpleGraph::TickLabel* SimpleGraph::TickAxis::Add(const vec2_t &from, const vec2_t &to, const size_t slot)
+{
+    _lines.push_back(from);
+    _lines.push_back(to);
+    // the lines are uploaded with the glyphs
+    _glyphs_aspect = 0;
 
-    // draw all labels
-    labellist::const_iterator i;
-    for( i=_labels.begin(); i!=_labels.end(); ++i)
-        (*i)->Draw();
+    if( slot >= _pool.size() )
+        return NULL;
+    _shown.push_back(_pool[slot]);
+    return _pool[slot];
+}
 
+void SimpleGraph::TickAxis::Draw(const Color &lines, const Color &labels, const float aspect)
+{
+    if( _glyphs_aspect != aspect ) {
+        if( !_lines.empty() )
+            _vbo.Set(_lines.data(), _lines.size());
+
+        _glyphs.Clear();
+        for( size_t i=0; i<_shown.size(); ++i )
+            _shown[i]->Layout( _glyphs, _shown[i]->position, .2f );
+        _glyphs_aspect = aspect;
+    }
+
+    lines.Activate();
+    _vbo.Draw(GL_LINES, 0, _lines.size());
+
+    labels.Activate();
+    _glyphs.Draw();
+}
+
+
+void SimpleGraph::SetAbsoluteTime(const bool absolute, const double start)
+{
+    _absolute_time = absolute;
+    _start_time = start;
+    _static_changed = true;
+    UpdateXTicks();
+}
+
+bool SimpleGraph::XTicksMoved() const
+{
+    if( _xtick_dx <= 0 )
+        return false;
+
+    const double wall = _start_time + _now;
+    const dvec2_t zero = {0, 0};
+    return ceil( (wall - _blocklist.XRange().Length()) / _xtick_dx ) != _xtick_first
+        || floor( wall / _xtick_dx ) != _xtick_last
+        || _blocklist.ToVertex(zero).x != _xtick_base;
+}
+
+void SimpleGraph::DrawScrollingTicks()
+{
+    // the x ticks only change if one of them left the plot,
+    // otherwise they are just moved along with the data
+    if( XTicksMoved() )
+        UpdateXTicks();
+
+    glPushMatrix();
+        glTranslatef( -2.0f * _blocklist.XRange().Center() / _blocklist.XRange().Length(), 0.0f, 0.0f );
+        _xaxis.Draw( TickColor, TickLabelColor, GetWindowAspect() );
+    glPopMatrix();
 }
 
 void SimpleGraph::UpdateTicks() {
+    UpdateXTicks();
+    UpdateYTicks();
+}
+
+void SimpleGraph::UpdateXTicks() {
 
-    DeleteTicks();
+    _xaxis.Clear();
+    // the scrolling ticks are drawn live
+    if( !_absolute_time )
+        _static_changed = true;
 
     //calulate rough estimate how many ticks:
+    const float len = _blocklist.XRange().Length();
     int ntx = ceil ( NTICKSFULLX *  _owner->XPixels() / GetWindowWidth());
-    float dx = _blocklist.XRange().Length() / ntx;
+    float dx = len / ntx;
     dx = roundX(dx);
-    ntx = floor( _blocklist.XRange().Length() / dx ) +1;
+    _xtick_dx = dx;
+    if( dx <= 0 )
+        return;
 
-    for( int i=0; i<ntx; ++i ) {
-        float x = 0 - i * dx;
-        AddXTick( x );
+    vec2_t from, to;
+    from.y = 1.0f;
+    to.y = -1.0f;
+
+    if( !_absolute_time ) {
+        ntx = floor( len / dx ) +1;
+
+        for( int i=0; i<ntx; ++i ) {
+            float x = 0 - i * dx;
+            from.x = to.x = GetXGlobal(x);
+            TickLabel* label = _xaxis.Add( from, to, i );
+            if( label ) {
+                vec2_t t = to;
+                t.y -= .1;
+                label->PlaceTime(t, x);
+            }
+        }
+        return;
+    }
+
+    // the multiples of dx in the visible part of the wall-clock time,
+    // in plot units relative to time 0 of the vertices. DrawScrollingTicks()
+    // moves them to the current x range.
+    const double wall = _start_time + _now;
+    _xtick_first = ceil( (wall - len) / dx );
+    _xtick_last = floor( wall / dx );
+    const dvec2_t zero = {0, 0};
+    _xtick_base = _blocklist.ToVertex(zero).x;
+
+    for( double k=_xtick_first; k<=_xtick_last; ++k ) {
+        const double t = k * dx;
+        const dvec2_t sample = {t - _start_time, 0};
+        from.x = to.x = 2.0f * _blocklist.ToVertex(sample).x / len;
+        // a tick keeps its label while it's visible
+        TickLabel* label = _xaxis.Add( from, to, (size_t) fmod(fmod(k, NTICKSMAX) + NTICKSMAX, NTICKSMAX) );
+        if( label ) {
+            vec2_t l = to;
+            l.y -= .1;
+            label->PlaceClock(l, t, dx);
+        }
     }
-      
+}
+
+void SimpleGraph::UpdateYTicks() {
+
+    _yaxis.Clear();
+    _static_changed = true;
+
     int nty = ceil (NTICKSFULLY * _owner->YPixels() / GetWindowHeight());
     float dy = _yrange.Length() / nty;
     float dy_r = roundX(dy);
@@ -348,23 +558,25 @@ void SimpleGraph::UpdateTicks() {
     // since the rounded ystart might be outside _yrange already
     // we scan with nty a little bit more around...
     const float ystart = roundX( _yrange.Center() - nty*dy/2 ) ;
+    size_t slot = 0;
     for( int i=-2; i<nty_r+2; ++i ) {
         float y = ystart + i * dy_r;
-        if(_yrange.Contains(y))
-            AddYTick( y );
+        if(!_yrange.Contains(y))
+            continue;
+
+        vec2_t from, to;
+        from.y = to.y = GetYGlobal(y);
+        from.x = -1.0f;
+        to.x = 1.0f;
+        TickLabel* label = _yaxis.Add( from, to, slot++ );
+        if( label ) {
+            vec2_t t = to;
+            t.x += .2;
+            label->PlaceNumber(t, y);
+        }
     }
 }
 
-void SimpleGraph::DeleteTicks()
-{
-    labellist::iterator i;
-    for( i=_labels.begin(); i != _labels.end(); ++i)
-        delete (*i);
-    _labels.clear();
-    _ticks.clear();
-}
-
-
 float SimpleGraph::roundX(float x) {
     if( x==0 || !isfinite(x) )
         return 0;
@@ -385,40 +597,6 @@ float SimpleGraph::roundX(float x) {
     return x;
 }
 
-void SimpleGraph::AddXTick(const float x) {
-    vec2_t t;
-    t.x = GetXGlobal(x);
-    t.y =   1.0f;
-    _ticks.push_back(t);
-    t.y = - 1.0f;
-    _ticks.push_back(t);
-
-    t.y -= .1;
-
-    TickLabel* label = new TickLabel( _owner, t, x );
-    label->SetTime(x);
-
-    _labels.push_back(label);
-
-}
-
-void SimpleGraph::AddYTick(const float y) {
-    vec2_t t;
-    t.y = GetYGlobal(y);
-    t.x =  -1.0f;
-    _ticks.push_back(t);
-    t.x =   1.0f;
-    _ticks.push_back(t);
-
-    t.x += .2;
-
-    TickLabel* label = new TickLabel( _owner, t, y );
-    label->SetNumber(y);
-
-    _labels.push_back(label);
-}
-
-
 SimpleGraph::AlarmLevels::AlarmLevels(const Color &color):
     AlarmColor(color)
 {
@@ -426,12 +604,11 @@ SimpleGraph::AlarmLevels::AlarmLevels(const Color &color):
 
 void SimpleGraph::AlarmLevels::Draw()
 {
-    if(_levels.Length()==0)
+    if(_levels.Length()==0 || _lines.empty())
         return;
     AlarmColor.Activate();
     glLineWidth(1.0f);
-    glVertexPointer(2, GL_FLOAT, 0, _lines.data());
-    glDrawArrays(GL_LINES, 0, _lines.size());
+    _vbo.Draw(GL_LINES, 0, _lines.size());
 }
 
 void SimpleGraph::AlarmLevels::SetLevels(const Interval& levels , const Interval &draw)
@@ -460,16 +637,20 @@ void SimpleGraph::AlarmLevels::Update()
 {
 
     Clear();
-    vec2_t t;
-    t.x = -1.0f;
-    t.y = _draw_levels.Min();
-    _lines.push_back(t);
-    t.x=1.0f;
-    _lines.push_back(t);
-
-    t.x = -1.0f;
-    t.y = _draw_levels.Max();
-    _lines.push_back(t);
-    t.x=1.0f;
-    _lines.push_back(t);
+    // levels outside of the plot area are skipped,
+    // so no clipping is needed when drawing them
+    const float levels[2] = { _draw_levels.Min(), _draw_levels.Max() };
+    for( int i=0; i<2; ++i ) {
+        if( levels[i] < -1.0f || levels[i] > 1.0f )
+            continue;
+        vec2_t t;
+        t.x = -1.0f;
+        t.y = levels[i];
+        _lines.push_back(t);
+        t.x = 1.0f;
+        _lines.push_back(t);
+    }
+
+    if( !_lines.empty() )
+        _vbo.Set(_lines.data(), _lines.size());
 }
@@ -0,0 +1,245 @@
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "SimulatedSource.h"
+#include "alarm.h"
+
+using namespace std;
+
+// the period of the thread
+#define SIMULATEDSOURCE_TICK 1e-3
+
+SimulatedSource::SimulatedSource():
+    _started(false),
+    _stop(false)
+{
+    pthread_mutex_init(&_mutex, NULL);
+}
+
+SimulatedSource::~SimulatedSource()
+{
+    if(_started) {
+        _stop = true;
+        pthread_join(_thread, NULL);
+    }
+    pthread_mutex_destroy(&_mutex);
+}
+
+bool SimulatedSource::Parse(const string& pvname, Signal& s)
+{
+    // the defaults
+    s.rate = 10;
+    s.period = 10;
+    s.amplitude = 1;
+    s.burst = 100;
+    s.disconnect = 0;
+    s.alarms = false;
+
+    stringstream ss(pvname.substr(strlen(SIMULATEDSOURCE_PREFIX)));
+    if(!getline(ss, s.unit, ':'))
+        return false;
+    if(s.unit == "sine")
+        s.pattern = Sine;
+    else if(s.unit == "noise")
+        s.pattern = Noise;
+    else if(s.unit == "step")
+        s.pattern = Step;
+    else if(s.unit == "burst")
+        s.pattern = Burst;
+    else
+        return false;
+
+    string option;
+    while(getline(ss, option, ':')) {
+        const size_t eq = option.find('=');
+        if(eq == string::npos)
+            return false;
+        const string key = option.substr(0, eq);
+        stringstream value(option.substr(eq+1));
+        bool ok;
+        if(key == "rate")            ok = (value >> s.rate) && s.rate > 0;
+        else if(key == "period")     ok = (value >> s.period) && s.period > 0;
+        else if(key == "amp")        ok = (value >> s.amplitude) && s.amplitude > 0;
+        else if(key == "burst")      ok = !!(value >> s.burst);
+        else if(key == "disconnect") ok = (value >> s.disconnect) && s.disconnect >= 0;
+        else if(key == "alarms")     ok = !!(value >> s.alarms);
+        else                         ok = false;
+        if(!ok)
+            return false;
+    }
+    return true;
+}
+
+bool SimulatedSource::Subscribe(const string& pvname, Epics::Producer p)
+{
+    Signal s;
+    if(!Parse(pvname, s))
+        return false;
+
+    s.producer = p;
+    s.start = Epics::I().GetCurrentTime();
+    s.updates = 0;
+    s.bursts = 0;
+    s.connected = false;
+    s.next_toggle = s.start;
+    s.severity = -1;
+    s.refresh = false;
+    s.has_value = false;
+    s.last_time = 0;
+    s.last_value = 0;
+    s.seed = (unsigned int) pvname.size();
+
+    pthread_mutex_lock(&_mutex);
+    _signals.push_back(s);
+    if(!_started) {
+        pthread_create(&_thread, 0, &SimulatedSource::start_thread, this);
+        _started = true;
+    }
+    pthread_mutex_unlock(&_mutex);
+    return true;
+}
+
+void SimulatedSource::Refresh(Epics::Producer p)
+{
+    // only the thread injects, so it does it with the next tick
+    pthread_mutex_lock(&_mutex);
+    for(size_t i=0;i<_signals.size();i++) {
+        if(_signals[i].producer == p)
+            _signals[i].refresh = true;
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+void SimulatedSource::Unsubscribe(Epics::Producer p)
+{
+    // the thread holds the mutex while injecting
+    pthread_mutex_lock(&_mutex);
+    for(size_t i=0;i<_signals.size();i++) {
+        if(_signals[i].producer == p) {
+            _signals.erase(_signals.begin()+i);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+void SimulatedSource::do_work()
+{
+    while(!_stop) {
+        pthread_mutex_lock(&_mutex);
+        const double now = Epics::I().GetCurrentTime();
+        for(size_t i=0;i<_signals.size();i++)
+            Tick(_signals[i], now);
+        pthread_mutex_unlock(&_mutex);
+
+        timespec t;
+        t.tv_sec = 0;
+        t.tv_nsec = (long)(1e9*SIMULATEDSOURCE_TICK);
+        nanosleep(&t, NULL);
+    }
+}
+
+void SimulatedSource::Tick(Signal& s, const double now)
+{
+    // connect right away, then toggle if asked to
+    if(now >= s.next_toggle) {
+        s.connected = !s.connected;
+        Epics::I().InjectConnection(s.producer, s.connected);
+        if(s.connected)
+            SendProperties(s);
+        // never again, if not disconnecting
+        s.next_toggle = s.disconnect > 0 ? s.next_toggle + s.disconnect : 1e300;
+    }
+
+    if(s.refresh) {
+        s.refresh = false;
+        if(s.connected) {
+            SendProperties(s);
+            if(s.has_value)
+                Epics::I().InjectValue(s.producer, s.last_time, s.last_value, s.severity);
+        }
+    }
+
+    // the updates while disconnected are lost,
+    // each update is sent when its time has come
+    const size_t due = (size_t)((now - s.start) * s.rate);
+    for(; s.updates < due; s.updates++) {
+        if(s.connected)
+            SendValue(s, s.start + (s.updates+1) / s.rate);
+    }
+
+    if(s.pattern == Burst) {
+        const size_t bursts = (size_t)((now - s.start) / s.period);
+        for(; s.bursts < bursts; s.bursts++) {
+            for(size_t i=0;i<s.burst && s.connected;i++)
+                SendValue(s, now);
+        }
+    }
+}
+
+double SimulatedSource::Value(Signal& s, const double t)
+{
+    const double noise = 2.0 * rand_r(&s.seed) / RAND_MAX - 1.0;
+    switch(s.pattern) {
+    case Sine:
+        return s.amplitude * sin(2*M_PI*t / s.period);
+    case Noise:
+        return s.amplitude * noise;
+    case Step:
+        return ((long)(t / s.period) % 2 == 0 ? -1 : 1) * s.amplitude;
+    case Burst:
+        return s.amplitude * (sin(2*M_PI*t / s.period) + 0.1*noise);
+    }
+    return 0;
+}
+
+void SimulatedSource::SendProperties(Signal& s)
+{
+    dbr_string_t egu;
+    strncpy(egu, s.unit.c_str(), sizeof(egu));
+    egu[sizeof(egu)-1] = '\0';
+    Epics::I().InjectProperty(s.producer, "EGU", egu, sizeof(egu));
+    const dbr_short_t prec = 3;
+    Epics::I().InjectProperty(s.producer, "PREC", &prec, sizeof(prec));
+
+    if(s.alarms) {
+        const dbr_double_t hihi = 0.9*s.amplitude, high = 0.7*s.amplitude;
+        const dbr_double_t low = -high, lolo = -hihi;
+        Epics::I().InjectProperty(s.producer, "HIHI", &hihi, sizeof(hihi));
+        Epics::I().InjectProperty(s.producer, "HIGH", &high, sizeof(high));
+        Epics::I().InjectProperty(s.producer, "LOW",  &low,  sizeof(low));
+        Epics::I().InjectProperty(s.producer, "LOLO", &lolo, sizeof(lolo));
+    }
+
+    if(s.severity >= 0) {
+        const dbr_enum_t sevr = s.severity;
+        Epics::I().InjectProperty(s.producer, "SEVR", &sevr, sizeof(sevr));
+    }
+}
+
+void SimulatedSource::SendValue(Signal& s, const double t)
+{
+    const double y = Value(s, t);
+
+    short severity = epicsSevNone;
+    if(s.alarms) {
+        if(fabs(y) >= 0.9*s.amplitude)
+            severity = epicsSevMajor;
+        else if(fabs(y) >= 0.7*s.amplitude)
+            severity = epicsSevMinor;
+    }
+    // as the SEVR field would tell
+    if(severity != s.severity) {
+        const dbr_enum_t sevr = severity;
+        Epics::I().InjectProperty(s.producer, "SEVR", &sevr, sizeof(sevr));
+        s.severity = severity;
+    }
+
+    Epics::I().InjectValue(s.producer, t, y, severity);
+    s.has_value = true;
+    s.last_time = t;
+    s.last_value = y;
+}
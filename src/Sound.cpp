@@ -49,6 +49,7 @@ bool Sound::Play(const string& name)
 
 Sound::Sound() : _running(true), 
     _pvname("GEN:ONLINEDISPLAYS:MUTE"), // the PV name to mute all displays for a specific time
+    _pv(NULL),
     _cur_item(NULL)
 {
     // create the loop & the context
@@ -117,7 +118,7 @@ Sound::Sound() : _running(true),
     // register global MUTE PV for all displays
     // request that ProcessEpicsData gets automatically called for each new DataItem
     _muted.Start();
-    Epics::I().addPV(_pvname, BIND_MEM_CB(&Sound::ProcessEpicsData, this), true);
+    _pv = Epics::I().addPV(_pvname, BIND_MEM_CB(&Sound::ProcessEpicsData, this), true);
 }
 
 void Sound::SetupWavItem(const string& name, const unsigned char *data, size_t size)
@@ -143,8 +144,7 @@ void Sound::ProcessEpicsData(const Epics::DataItem *i)
         break;
         
     case Epics::NewValue: {
-        vec2_t* d = (vec2_t*)i->data;
-        _muted_for = d->y>0 ? d->y : 0;
+        _muted_for = i->value.y>0 ? i->value.y : 0;
         break;               
     }
     default: 
@@ -172,7 +172,7 @@ Sound::~Sound()
         delete it->second;
     }
     
-    Epics::I().removePV(_pvname);
+    Epics::I().removePV(_pv);
 }
 
 void Sound::do_work()
@@ -1,11 +1,10 @@
 #include "TextLabel.h"
-#include "TextRenderer.h"
 
 using namespace std;
 
 
 TextLabel::TextLabel( const Window* owner, const float x1, const float y1, const float x2, const float y2):
-    Widget(owner), _color( dTextColor ), _rext(x1, y1, x2, y2)
+    Widget(owner), _color( dTextColor ), _rext(x1, y1, x2, y2), _batch_aspect(0)
 {
 }
 
@@ -15,40 +14,46 @@ TextLabel::~TextLabel()
 
 void TextLabel::Draw() const
 {
-
-    
-    const float rect_ratio = _rext.Width() / _rext.Height() ;
-    const float text_ratio = _texture.GetAspectRatio()/GetWindowAspect();
-    Rectangle   box(_rext);       // the actual drawing box, always smaller than the user defined text rectangle
-    
-    if( text_ratio >= rect_ratio ) {
-        box= Rectangle( _rext.Center(), _rext.Width(), 1.0/text_ratio * _rext.Width() );
-    } else {
-        box= Rectangle( _rext.Center(), text_ratio * _rext.Height() , _rext.Height() );
+    if( _text.empty() )
+        return;
+
+    if( _batch_aspect != GetWindowAspect() ) {
+
+        const float rect_ratio = _rext.Width() / _rext.Height() ;
+        const float text_ratio = _text.size() * GlyphAtlas::I().GetAspectRatio() / GetWindowAspect();
+        Rectangle   box(_rext);       // the actual drawing box, always smaller than the user defined text rectangle
+
+        if( text_ratio >= rect_ratio ) {
+            box= Rectangle( _rext.Center(), _rext.Width(), 1.0/text_ratio * _rext.Width() );
+        } else {
+            box= Rectangle( _rext.Center(), text_ratio * _rext.Height() , _rext.Height() );
+        }
+
+        // one cell per character, the font is monospaced
+        const float w = box.Width() / _text.size();
+        const float y1 = box.Center().Y() - box.Height() / 2.0f;
+        const float y2 = box.Center().Y() + box.Height() / 2.0f;
+        float x = box.Center().X() - box.Width() / 2.0f;
+
+        _batch.Clear();
+        for( size_t p=0; p<_text.size(); ++p ) {
+            _batch.Add( _text[p], x, y1, x + w, y2 );
+            x += w;
+        }
+        _batch_aspect = GetWindowAspect();
     }
-    
-    glEnable(GL_TEXTURE_2D);
-    glEnable(GL_BLEND);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glBlendFunc(GL_SRC_ALPHA,GL_ONE);
-    _color.Activate();
-    _texture.Activate();
-    
-    box.Draw( GL_TRIANGLE_FAN );
 
-    glDisable(GL_BLEND);
-    glDisable(GL_TEXTURE_2D);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);   
+    _color.Activate();
+    _batch.Draw();
     
     // uncomment for debugging aspect ratio stuff...
-    //box.Draw( GL_LINE_LOOP );
     //_rext.Draw( GL_LINE_LOOP );
-    
-   
 }
 
 void TextLabel::SetText( const string &text )
 {
-    TextRenderer render;
-    render.Text2Texture( _texture, text );
+    if( text == _text )
+        return;
+    _text = text;
+    _batch_aspect = 0;
 }
@@ -3,6 +3,9 @@
 #include <sstream>
 #include <stdint.h>  // for uint32_t
 #include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
 #include "magick/MagickCore.h"
 #include "GLTools.h"
 
@@ -107,6 +110,68 @@ void TextRenderer::Text2Texture(Texture& tex, const string &text )
     BindTexture(tex, GL_LUMINANCE);
 }
 
+// the label: coder reads a file for a leading '@',
+// and interprets '%' and backslash escapes
+static string LabelEscape( const char c )
+{
+    switch( c ) {
+    case '@':  return "\\@";
+    case '%':  return "%%";
+    case '\\': return "\\\\";
+    default:   return string(1, c);
+    }
+}
+
+void TextRenderer::Glyphs2Texture(Texture& tex, const string &glyphs, const size_t columns )
+{
+    // render all glyphs first, the largest one gives the cell size
+    vector<MagickWand*> images(glyphs.size());
+    size_t cell_w = 1;
+    size_t cell_h = 1;
+    for( size_t i=0; i<glyphs.size(); ++i ) {
+        std::stringstream rendercmd;
+        rendercmd << "label:" << LabelEscape(glyphs[i]);
+        SetTextOptions();
+        if( !MagickReadImage(_mw, rendercmd.str().c_str()) ) {
+            // an atlas with holes would go unnoticed
+            ExceptionType severity;
+            char* description = MagickGetException(_mw, &severity);
+            cerr << "Cannot render glyph '" << glyphs[i] << "': " << description << endl;
+            MagickRelinquishMemory(description);
+            exit(EXIT_FAILURE);
+        }
+        images[i] = CloneMagickWand(_mw);
+        ClearMagickWand(_mw);
+        cell_w = max(cell_w, (size_t) MagickGetImageWidth(images[i]));
+        cell_h = max(cell_h, (size_t) MagickGetImageHeight(images[i]));
+    }
+
+    const size_t rows = (glyphs.size() + columns - 1) / columns;
+    const size_t width = columns * cell_w;
+    const size_t height = rows * cell_h;
+    _w_pow2 = RoundPow2(width);
+    _h_pow2 = RoundPow2(height);
+    _u = (float) width / _w_pow2;
+    _v = (float) height / _h_pow2;
+    _aspect_orig = (float) cell_w / (float) cell_h;
+
+    // on black, so the antialiasing ends up in the intensity
+    PixelWand* black = NewPixelWand();
+    PixelSetColor(black, "black");
+    MagickNewImage(_mw, _w_pow2, _h_pow2, black);
+    DestroyPixelWand(black);
+
+    for( size_t i=0; i<glyphs.size(); ++i ) {
+        const size_t x = (i % columns) * cell_w + (cell_w - MagickGetImageWidth(images[i])) / 2;
+        const size_t y = (i / columns) * cell_h + (cell_h - MagickGetImageHeight(images[i])) / 2;
+        MagickCompositeImage(_mw, images[i], OverCompositeOp, x, y);
+        DestroyMagickWand(images[i]);
+    }
+
+    CopyToBuffer(GL_LUMINANCE);
+    BindTexture(tex, GL_LUMINANCE);
+}
+
 void TextRenderer::SetTextOptions()
 {
     MagickSetSize(_mw,0,0);    
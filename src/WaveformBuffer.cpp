@@ -0,0 +1,87 @@
+#include "WaveformBuffer.h"
+
+#include <cmath>
+
+using namespace std;
+
+static void extend( float& ymin, float& ymax, const float y )
+{
+    if( isnan(y) )
+        return;
+    if( isnan(ymin) || y < ymin ) ymin = y;
+    if( isnan(ymax) || y > ymax ) ymax = y;
+}
+
+WaveformBuffer::WaveformBuffer():
+    _back(0),
+    _ready(1),
+    _front(2),
+    _max_vertices(0)
+{
+}
+
+void WaveformBuffer::Write( const double* values, const size_t n, const double time )
+{
+    Slab& s = _slabs[_back];
+    s.elements = n;
+    s.time = time;
+
+    float ymin = nanf("");
+    float ymax = nanf("");
+
+    const size_t max = _max_vertices;
+    if( max < 2 || n <= max ) {
+        s.vertices.resize(n);
+        for( size_t i=0; i<n; ++i ) {
+            vec2_t& v = s.vertices[i];
+            v.x = i;
+            v.y = values[i];
+            extend(ymin, ymax, v.y);
+        }
+    }
+    else {
+        // the min and max of each bucket in index order,
+        // so spikes are kept
+        const size_t buckets = max/2;
+        s.vertices.resize(2*buckets);
+        size_t k = 0;
+        for( size_t b=0; b<buckets; ++b ) {
+            const size_t begin = b*n/buckets;
+            const size_t end = (b+1)*n/buckets;
+            size_t imin = begin;
+            size_t imax = begin;
+            for( size_t i=begin+1; i<end; ++i ) {
+                if( values[i] < values[imin] ) imin = i;
+                if( values[i] > values[imax] ) imax = i;
+            }
+            const size_t first = imin < imax ? imin : imax;
+            const size_t second = imin < imax ? imax : imin;
+
+            s.vertices[k].x = first;
+            s.vertices[k].y = values[first];
+            ++k;
+            if( second != first ) {
+                s.vertices[k].x = second;
+                s.vertices[k].y = values[second];
+                ++k;
+            }
+            extend(ymin, ymax, values[imin]);
+            extend(ymin, ymax, values[imax]);
+        }
+        s.vertices.resize(k);
+    }
+    s.yrange = Interval(ymin, ymax);
+
+    // the slab must be completely written before it's published
+    __sync_synchronize();
+    _back = __sync_lock_test_and_set(&_ready, _back | FRESH) & ~FRESH;
+}
+
+bool WaveformBuffer::Acquire()
+{
+    if( !(_ready & FRESH) )
+        return false;
+    _front = __sync_lock_test_and_set(&_ready, _front) & ~FRESH;
+    __sync_synchronize();
+    return true;
+}
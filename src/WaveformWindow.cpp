@@ -0,0 +1,179 @@
+#include <iostream>
+#include <sstream>
+#include "Callback.h"
+#include "WaveformWindow.h"
+#include "ConfigManager.h"
+
+using namespace std;
+
+WaveformWindow::WaveformWindow(
+        WindowManager* owner,
+        const std::string& pvname,
+        const float xscale,
+        const float yscale,
+        const std::string& name ) :
+    Window(owner, name.empty() ? pvname : name, xscale, yscale),
+    _pvname(pvname),
+    _pv(NULL),
+    _initialized(false),
+    WindowArea( dBackColor, dWindowBorderColor),
+    PlotArea( dPlotBackground, dPlotBorderColor),
+    text(this, -0.98, .66, .99, .98),
+    _yrange(nanf(""),nanf("")),
+    _color(dPlotColor),
+    _decimate(true),
+    _epics_connected(false),
+    discon_lbl(this, -.1, -.1, .8, .9)
+{
+    text.SetText(pvname);
+    discon_lbl.SetColor(kPink);
+    discon_lbl.SetText("Disconnected");
+
+    // don't forget to call Init()
+}
+
+int WaveformWindow::Init()
+{
+    if(_pvname.empty())
+        return 1;
+
+    ConfigManager::I().addCmd(Name()+"_Decimate", BIND_MEM_CB(&WaveformWindow::callbackSetDecimate, this));
+
+    int ret = Window::Init();
+    // the arrays are written to the buffer directly,
+    // the cb is triggered via processNewDataForPV
+    _pv = Epics::I().addPV(_pvname, BIND_MEM_CB(&WaveformWindow::ProcessEpicsData, this), false, &_buffer);
+    // return & save status for dtor
+    _initialized = ret == 0;
+    return ret;
+}
+
+WaveformWindow::~WaveformWindow() {
+    if(_initialized) {
+        Epics::I().removePV(_pv);
+    }
+    ConfigManager::I().removeCmd(Name()+"_Decimate");
+}
+
+string WaveformWindow::callbackSetDecimate(const string& arg){
+    stringstream ss(arg);
+    int decimate;
+    if(!(ss >> decimate))
+        return "Value must be 0 or 1";
+    _decimate = decimate != 0;
+    return ""; // success
+}
+
+static const float scale_y = 0.72f;
+static const float scale_x = 0.9f;
+
+void WaveformWindow::Poll() {
+
+    // the items tell about the connection and the properties
+    Epics::I().processNewDataForPV(_pv);
+
+    // applies to the arrays received from now on
+    _buffer.SetMaxVertices(_decimate ? 2 * scale_x * XPixels() : 0);
+    if( _buffer.Acquire() ) {
+        const WaveformBuffer::Slab& s = _buffer.Front();
+        if( !s.vertices.empty() )
+            _vbo.Set(&s.vertices[0], s.vertices.size());
+        SetDirty();
+    }
+}
+
+void WaveformWindow::Draw() {
+
+    const WaveformBuffer::Slab& s = _buffer.Front();
+
+    // Window border
+    WindowArea.Draw();
+    text.Draw();
+
+    glPushMatrix();
+        glTranslatef(0, -.12, 0);
+        glScalef(scale_x, scale_y, 1.0f);
+
+        PlotArea.Draw();
+
+        // LOPR/HOPR are often left at zero
+        Interval yrange = s.yrange;
+        if( _yrange.Length() > 0 )
+            yrange.Extend(_yrange);
+        if( !(yrange.Length() > 0) ) {
+            // flat line or no limits at all
+            yrange = Interval(yrange.Center()-1, yrange.Center()+1);
+        }
+
+        if( s.vertices.size() >= 2 && isfinite(yrange.Length()) ) {
+            glPushMatrix();
+
+                // change to graph coordinates, the x axis is the element index
+                const float xlen = s.elements - 1;
+                glScalef( 2.0f / xlen, 2.0f / yrange.Length(), 1.0f );
+                glTranslatef( -xlen / 2.0f, -yrange.Center(), 0.0f );
+
+                // one strip, uploaded once per array
+                _color.Activate();
+                _vbo.Draw(GL_LINE_STRIP, 0, s.vertices.size());
+
+            glPopMatrix();
+        }
+    glPopMatrix();
+
+    if( !_epics_connected ) {
+        discon_lbl.Draw();
+    }
+}
+
+void WaveformWindow::ProcessEpicsData(const Epics::DataItem* i) {
+
+    SetDirty();
+
+    switch (i->type) {
+    case Epics::Connected:
+        _epics_connected = true;
+        break;
+
+    case Epics::Disconnected:
+        _epics_connected = false;
+        break;
+
+    case Epics::NewProperties: {
+        ProcessEpicsProperties(i->attr, i->data);
+        break;
+    }
+    default:
+        // the arrays are in the buffer already
+        break;
+    }
+}
+
+void WaveformWindow::ProcessEpicsProperties(const string& attr, void* d) {
+
+    if(attr == "SEVR") {
+        switch ((epicsAlarmSeverity)(*(dbr_enum_t*)d)) {
+        case epicsSevMinor:   _color = dMinorAlarm; break;
+        case epicsSevMajor:   _color = dMajorAlarm; break;
+        case epicsSevInvalid: _color = dInvalidAlarm; break;
+        default: _color = dPlotColor; break;
+        }
+    }
+    else if(attr == "LOPR") {
+        _yrange.Min() = *(dbr_double_t*)d;
+    }
+    else if(attr == "HOPR") {
+        _yrange.Max() = *(dbr_double_t*)d;
+    }
+    else if(attr == "EGU") {
+        // append the unit to the title
+        stringstream title;
+        string u((char*)d);
+        title << _pvname;
+        if(!u.empty()) {
+            title << " / " << u;
+            text.SetText(title.str());
+        }
+    }
+    // the alarm limits and the precision are not shown
+}
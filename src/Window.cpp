@@ -15,7 +15,10 @@ Window::Window(WindowManager *owner, const string &name, const float xscale, con
     _owner(owner),
     _name(name), 
     _x_pixels(xscale), 
-    _y_pixels(yscale) {
+    _y_pixels(yscale),
+    _x_offset(0),
+    _y_offset(0),
+    _dirty(true) {
     
    
 }
@@ -32,6 +35,17 @@ int Window::Init()
     return 0;
 }
 
+void Window::Scissor(const float x1, const float y1, const float x2, const float y2) const
+{
+    // whole pixels covering the rectangle
+    const int px1 = floor( _x_offset + (x1 + 1.0f) / 2.0f * _x_pixels );
+    const int py1 = floor( _y_offset + (y1 + 1.0f) / 2.0f * _y_pixels );
+    const int px2 = ceil( _x_offset + (x2 + 1.0f) / 2.0f * _x_pixels );
+    const int py2 = ceil( _y_offset + (y2 + 1.0f) / 2.0f * _y_pixels );
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(px1, py1, px2 - px1, py2 - py1);
+}
+
 string Window::callbackRemoveWindow(const string &arg)
 {
     return _owner->RemoveWindow(_name)==0 ? "" : "Window not found.";    
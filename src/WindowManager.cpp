@@ -1,20 +1,23 @@
 #include <iostream>
+#include <sstream>
 #include <stdlib.h>
 
 #include "ConfigManager.h"
 #include "WindowManager.h"
 #include "PlotWindow.h"
 #include "ImageWindow.h"
+#include "WaveformWindow.h"
 
 using namespace std;
 
 WindowManager::WindowManager(const int dx, const int dy): 
-    _size_x(dx), _size_y(dy), _color(1.0,1.0,1.0)
+    _size_x(dx), _size_y(dy), _color(1.0,1.0,1.0), _damaged(true)
 {
     // register the callbacks in the ConfigManager
     ConfigManager::I().addCmd("RemoveAllWindows",BIND_MEM_CB(&WindowManager::callbackRemoveAllWindows,this));
     ConfigManager::I().addCmd("AddPlotWindow",BIND_MEM_CB(&WindowManager::callbackAddPlotWindow,this));
     ConfigManager::I().addCmd("AddImageWindow",BIND_MEM_CB(&WindowManager::callbackAddImageWindow,this));    
+    ConfigManager::I().addCmd("AddWaveformWindow",BIND_MEM_CB(&WindowManager::callbackAddWaveformWindow,this));
     // prepare "no windows" texture
     _render.Text2Texture( _tex, "No Windows. Telnet to port 1337.");
 }
@@ -63,8 +66,23 @@ int WindowManager::RemoveWindow(const string &name)
     return 1;
 }
 
-void WindowManager::Draw(){
-    
+bool WindowManager::Draw( const bool preserved ){
+
+    // let the windows fetch their data, which
+    // tells if they changed since the last frame
+    bool dirty = _damaged;
+    for( size_t i=0; i<NumWindows(); ++i ) {
+        _window_list[i]->Poll();
+        dirty |= _window_list[i]->IsDirty();
+    }
+
+    if( !dirty )
+        return false;
+
+    const bool all = _damaged || !preserved;
+    if( all )
+        glClear( GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
+
     float dy = 2. / _rows.size();
     float dx = 0;
     
@@ -75,12 +93,24 @@ void WindowManager::Draw(){
     for ( size_t row = 0; row < _rows.size() ; ++row){
         dx = 2. / _rows.at(row);
         for ( int in_row = 0 ; in_row < _rows.at(row) ; ++in_row ){
+            Window* win = _window_list.at(i_window);
+            i_window++;
+            if( !all && !win->IsDirty() )
+                continue;
+
+            if( !all ) {
+                // the other windows stay as they are
+                win->Scissor(-1, -1, 1, 1);
+                glClear( GL_COLOR_BUFFER_BIT );
+                glDisable(GL_SCISSOR_TEST);
+            }
+
             wscalex = 1. / _rows.at(row);
             glPushMatrix();
             glTranslatef(-1 + (dx / 2) + (in_row * dx ),1 - (dy / 2. ) - (row * dy ),0.);
             glScalef( wscalex , wscaley ,1);
-            _window_list.at(i_window)->Draw();
-            i_window++;
+            win->Draw();
+            win->ClearDirty();
             glPopMatrix();
         }
     }
@@ -108,7 +138,9 @@ void WindowManager::Draw(){
         glPopMatrix();
         
     }
-    
+
+    _damaged = false;
+    return true;
 }
 
 
@@ -123,7 +155,14 @@ string WindowManager::callbackRemoveAllWindows(const string &arg){
 
 string WindowManager::callbackAddPlotWindow(const string &arg)
 {
-    return AddWindow(new PlotWindow(this, arg));
+    // the window name is optional, it's needed to
+    // display the same PV in several windows
+    stringstream ss(arg);
+    string pvname, name;
+    if(!(ss >> pvname))
+        return "No PV name given";
+    ss >> name;
+    return AddWindow(new PlotWindow(this, pvname, "Always label your axes", "Always label your axes", 1, 1, name));
 }
 
 string WindowManager::callbackAddImageWindow(const string &arg)
@@ -131,7 +170,19 @@ string WindowManager::callbackAddImageWindow(const string &arg)
     return AddWindow(new ImageWindow(this, arg));
 }
 
+string WindowManager::callbackAddWaveformWindow(const string &arg)
+{
+    // the window name is optional, as for PlotWindows
+    stringstream ss(arg);
+    string pvname, name;
+    if(!(ss >> pvname))
+        return "No PV name given";
+    ss >> name;
+    return AddWindow(new WaveformWindow(this, pvname, 1, 1, name));
+}
+
 void WindowManager::alignWindows(){
+    _damaged = true;
     _rows.clear();
     int row = -1;
     size_t i = 0;
@@ -173,6 +224,9 @@ void WindowManager::alignWindows(){
             wscalex = 1. / _rows.at(row);
             _window_list.at(i_window)->XPixels() = wscalex * GetWindowWidth();
             _window_list.at(i_window)->YPixels() = wscaley * GetWindowHeight();
+            // GL window coordinates start at the bottom
+            _window_list.at(i_window)->XOffset() = in_row * wscalex * GetWindowWidth();
+            _window_list.at(i_window)->YOffset() = (_rows.size() - row - 1) * wscaley * GetWindowHeight();
             _window_list.at(i_window)->Update();
             i_window++;
         }